@@ -5,23 +5,137 @@
 #include <iostream>
 #include <algorithm>
 #include <cstring>
+#include <cmath>
 #include <stdexcept>
+#include <string>
+#include <chrono>
+#include <type_traits>
+#include <new>
+#include <cstddef>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <queue>
+#include <deque>
+#include <exception>
+#include <cstdint>
+#include <climits>
+#include <system_error>
+#include <fstream>
+#include <cstdio>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 using namespace std;
 
+// Counters describing how a Stash has used its memory
+struct StashStats
+{
+    long long inflations = 0;   // Number of times the storage grew
+    long long contractions = 0; // Number of times the storage shrank
+    long long bytesCopied = 0;  // Bytes moved inside the Stash by growth, shrinking and removal
+    long long bytesZeroed = 0;  // Bytes cleared in fresh storage
+    int peakQuantity = 0;       // Largest number of storage spaces held at once
+    double utilization = 0.0;   // Fraction of storage spaces in use right now
+};
+
+// Typed view over contiguous Stash elements; valid until the Stash reallocates
+template <typename T>
+class StashSpan
+{
+private:
+    T* first;    // First element
+    int length;  // Number of elements
+
+public:
+    StashSpan(T* first, int length) : first(first), length(length) {}
+
+    T* begin() const { return first; }
+    T* end() const { return first + length; }
+    int size() const { return length; }
+    T& operator[](int index) const { return first[index]; } // Unchecked access
+    StashSpan subspan(int offset, int count) const { return StashSpan(first + offset, count); }
+};
+
+// How a Stash grows, shrinks and lays out its storage. A shrink leaves the
+// Stash at shrinkTarget utilization, well above the grow point, and is only
+// allowed once shrinkDelay * quantity adds and removes in a row have found it
+// below shrinkThreshold; any operation at or above the threshold restarts the
+// count, so a workload hovering near a boundary cannot thrash between the two
+struct StashPolicy
+{
+    double growthFactor = 2.0;    // Capacity multiplier when the Stash is full
+    double shrinkThreshold = 0.3; // Utilization below which the Stash shrinks
+    double shrinkTarget = 0.5;    // Utilization right after a shrink
+    double shrinkDelay = 0.5;     // Operations spent sparse before a shrink, as a fraction of quantity
+    int minCapacity = 16;         // Never shrink below this many spaces
+    int alignment = 0;            // Byte alignment of the storage, such as 32 or 64 for SIMD; 0 for the default
+};
+
+// Heap bytes aligned to alignment; 0 and alignments new[] already meets use plain new[]
+unsigned char* alignedAllocate(size_t bytes, int alignment)
+{
+    if (alignment <= static_cast<int>(alignof(max_align_t)))
+    {
+        return new unsigned char[bytes];
+    }
+    return static_cast<unsigned char*>(::operator new[](bytes, align_val_t(alignment)));
+}
+
+// Free what alignedAllocate returned for the same alignment
+void alignedFree(unsigned char* block, int alignment)
+{
+    if (alignment <= static_cast<int>(alignof(max_align_t)))
+    {
+        delete[] block;
+        return;
+    }
+    ::operator delete[](block, align_val_t(alignment));
+}
+
 class Stash
 {
 private:
     int size;      // Size of each space
     int quantity;  // Number of storage spaces
     int next;      // Next empty space
-    // Dynamically allocated array of bytes:
+    // Dynamically allocated array of bytes, or inlineBuffer while it fits:
     unsigned char* storage;
+    static const int INLINE_BYTES = 64;
+    alignas(alignof(max_align_t)) unsigned char inlineBuffer[INLINE_BYTES]; // Small Stashes live here
+    // Owners of the heap storage, set up whenever copy-on-write storage is
+    // created so copying never has to write to the source:
+    atomic<int>* shares;
+    bool copyOnWrite;  // Copies share storage until one of them mutates
+    bool verbose;      // Report every memory operation on cout
+    StashStats stats;  // Memory usage counters
+    StashPolicy policy;     // Growth and shrink rules
+    long long quietOps;     // Consecutive adds and removes spent below the shrink threshold
     
-    int increment() // Dynamically increase the size of the array by doubling it
+    int increment() // Dynamically increase the size of the array by the growth factor
     {
-        return (quantity == 0) ? 1 : quantity;
+        double grow = static_cast<double>(quantity) * (policy.growthFactor - 1.0);
+        return max(1, static_cast<int>(min(grow, static_cast<double>(INT_MAX - quantity))));
     }
+
+    void noteOperations(int ops); // Count adds and removes towards the shrink rules
+    void shrinkIfSparse(); // Contract automatically when the policy allows it
+    unsigned char* allocate(int sz, int& spaces, int alignment); // Storage for at least spaces elements
+    void releaseStorage(); // Drop this Stash's hold on its storage
+    void unshare(); // Take a private copy of shared storage before mutating it
+    void trackShares(); // Give copy-on-write heap storage its owner count
+    bool ownsBytes(const void* bytes) const; // Pointer lies inside the current storage
+
+    template <typename Doomed>
+    int compact(Doomed doomed); // Drop marked elements in one pass
     
 public:
     // The rule of five:
@@ -30,7 +144,7 @@ public:
     // 3. Copy assignment operator
     // 4. Move constructor
     // 5. Move assignment operator
-    Stash(int sz, int initialCapacity = 16); // Constructor
+    Stash(int sz, int initialCapacity = 16, const StashPolicy& policy = StashPolicy()); // Constructor
     ~Stash(); // Destructor
     Stash(const Stash& other); // Copy constructor
     Stash& operator=(const Stash& other); // Copy assignment operator
@@ -39,25 +153,63 @@ public:
 
     // Member functions
     void stashInfo() const; // Print information about the Stash
+    const StashPolicy& getPolicy() const { return policy; } // Growth and shrink rules in use
+    void setVerbose(bool on) { verbose = on; } // Turn the per-operation report on or off
+    void setCopyOnWrite(bool on) { copyOnWrite = on; trackShares(); } // Let later copies share storage until written
+    bool isShared() const { return shares != nullptr && shares->load() > 1; } // Storage is shared with a copy
+    StashStats statistics() const; // Snapshot of the memory usage counters
+    void resetStatistics(); // Start counting from the current state
     void cleanUp(); // Clean up the Stash
     int add(const void* element); // Add an element
-    void* fetch(int index); // Fetch an element
+    int addRange(const void* elements, int count); // Add several contiguous elements at once
+    void* fetch(int index); // Fetch an element for writing, unsharing the storage first
+    const void* fetch(int index) const; // Fetch an element for reading
+    template <typename T>
+    StashSpan<T> view(); // Typed view over all elements, sizeof(T) must equal the element size
+    template <typename T>
+    StashSpan<const T> view() const; // Read-only typed view over all elements
     int count() const { return next; } // Count the number of elements
+    bool isInline() const { return storage == inlineBuffer; } // Elements are kept inside the object
     void inflate(int increase); // Increase the size of the array
     void remove(int index); // Remove an element at specified position
-    void contract(double threshold = 0.3); // Release memory when necessary
+    void removeUnordered(int index); // Remove an element by moving the last one into its place
+    int removeMany(const int* indices, int count); // Remove the elements at the listed positions
+    template <typename Predicate>
+    int removeIf(Predicate pred); // Remove every element the predicate accepts
+    void contract(); // Release memory when utilization is below the policy threshold
+    void contract(double threshold); // Release memory when utilization is below threshold
+    template <typename Less>
+    void sort(Less less); // Sort in place with a comparator over element pointers
+    template <typename Less>
+    int lowerBound(const void* key, Less less) const; // Binary search in a sorted Stash
+    template <typename Less>
+    int find(const void* key, Less less) const; // Position of an element equal to key, or -1
+    void save(const string& path) const; // Write a binary snapshot
+    static Stash load(const string& path, const StashPolicy& policy = StashPolicy()); // Restore a snapshot
 }; // Stash
 
 // Constructor
-Stash::Stash(int sz, int initialCapacity) : 
-    size(sz), quantity(initialCapacity), next(0)
+Stash::Stash(int sz, int initialCapacity, const StashPolicy& policy) : 
+    size(sz), quantity(initialCapacity), next(0), storage(nullptr), shares(nullptr), copyOnWrite(false),
+    verbose(false), policy(policy), quietOps(0)
 {
+    if (policy.growthFactor <= 1.0 || policy.minCapacity < 1 ||
+        policy.shrinkThreshold < 0.0 || policy.shrinkThreshold >= policy.shrinkTarget || policy.shrinkTarget > 1.0)
+    {
+        throw invalid_argument("Stash: Policy needs growthFactor > 1, minCapacity >= 1 and 0 <= shrinkThreshold < shrinkTarget <= 1");
+    }
+    if (policy.alignment < 0 || (policy.alignment & (policy.alignment - 1)) != 0)
+    {
+        throw invalid_argument("Stash: Policy alignment must be 0 or a power of two");
+    }
+
     try 
     {
-        storage = new unsigned char[sz * quantity];
+        storage = allocate(size, quantity, policy.alignment);
         // Initialize storage to zero:
         memset(storage, 0, size * quantity);
-        cout << "Stash created with size: " << size << ", quantity: " << quantity << endl;
+        stats.bytesZeroed = static_cast<long long>(size) * quantity;
+        stats.peakQuantity = quantity;
     }
     catch(std::bad_alloc&) 
     {
@@ -71,17 +223,30 @@ Stash::Stash(int sz, int initialCapacity) :
 // Destructor
 Stash::~Stash()
 {
-    delete[] storage;
+    releaseStorage();
 }
 
-// Copy constructor
+// Copy constructor; a copy-on-write Stash shares its heap storage instead of copying it
 Stash::Stash(const Stash& other) : 
-    size(other.size), quantity(other.quantity), next(other.next)
+    size(other.size), quantity(other.quantity), next(other.next), storage(nullptr), shares(nullptr),
+    copyOnWrite(other.copyOnWrite), verbose(other.verbose), policy(other.policy), quietOps(0)
 {
+    if (other.copyOnWrite && other.shares != nullptr)
+    {
+        ++*other.shares;
+        shares = other.shares;
+        storage = other.storage;
+        stats.peakQuantity = quantity;
+        return;
+    }
+
     try 
     {
-        storage = new unsigned char[size * quantity];
+        storage = allocate(size, quantity, policy.alignment);
         memcpy(storage, other.storage, size * next);
+        stats.bytesCopied = static_cast<long long>(size) * next;
+        stats.peakQuantity = quantity;
+        trackShares();
     }
     catch(std::bad_alloc&) 
     {
@@ -98,20 +263,46 @@ Stash& Stash::operator=(const Stash& other)
 {
     if (this != &other)
     {
+        if (other.copyOnWrite && other.shares != nullptr)
+        {
+            ++*other.shares;
+            releaseStorage();
+
+            size = other.size;
+            quantity = other.quantity;
+            next = other.next;
+            storage = other.storage;
+            shares = other.shares;
+            copyOnWrite = true;
+            verbose = other.verbose;
+            policy = other.policy;
+            quietOps = 0;
+            stats.peakQuantity = max(stats.peakQuantity, quantity);
+            return *this;
+        }
+
         try 
         {
             // Create new storage first
-            unsigned char* newStorage = new unsigned char[other.size * other.quantity];
+            int newQuantity = other.quantity;
+            unsigned char* newStorage = allocate(other.size, newQuantity, other.policy.alignment);
             memcpy(newStorage, other.storage, other.size * other.next);
             
             // Delete old storage
-            delete[] storage;
+            releaseStorage();
             
             // Update member variables
             size = other.size;
-            quantity = other.quantity;
+            quantity = newQuantity;
             next = other.next;
             storage = newStorage;
+            copyOnWrite = other.copyOnWrite;
+            trackShares();
+            verbose = other.verbose;
+            policy = other.policy;
+            quietOps = 0;
+            stats.bytesCopied += static_cast<long long>(size) * next;
+            stats.peakQuantity = max(stats.peakQuantity, quantity);
         }
         catch(std::bad_alloc&) 
         {
@@ -122,11 +313,19 @@ Stash& Stash::operator=(const Stash& other)
     return *this;
 }
 
-// Move constructor
+// Move constructor; inline elements have to be copied, heap storage is simply taken over
 Stash::Stash(Stash&& other) noexcept : 
-    size(other.size), quantity(other.quantity), next(other.next), storage(other.storage)
+    size(other.size), quantity(other.quantity), next(other.next), storage(other.storage), shares(other.shares),
+    copyOnWrite(other.copyOnWrite), verbose(other.verbose), stats(other.stats), policy(other.policy),
+    quietOps(other.quietOps)
 {
+    if (other.isInline())
+    {
+        memcpy(inlineBuffer, other.inlineBuffer, INLINE_BYTES);
+        storage = inlineBuffer;
+    }
     other.storage = nullptr; // Prevent deletion in destructor
+    other.shares = nullptr;
     other.quantity = 0;
     other.next = 0;
     other.size = 0;
@@ -138,16 +337,28 @@ Stash& Stash::operator=(Stash&& other) noexcept
     if (this != &other)
     {
         // Release current resources
-        delete[] storage;
+        releaseStorage();
         
         // Transfer ownership
         size = other.size;
         quantity = other.quantity;
         next = other.next;
         storage = other.storage;
+        shares = other.shares;
+        copyOnWrite = other.copyOnWrite;
+        if (other.isInline())
+        {
+            memcpy(inlineBuffer, other.inlineBuffer, INLINE_BYTES);
+            storage = inlineBuffer;
+        }
+        verbose = other.verbose;
+        stats = other.stats;
+        policy = other.policy;
+        quietOps = other.quietOps;
         
         // Reset source object
         other.storage = nullptr;
+        other.shares = nullptr;
         other.size = 0;
         other.quantity = 0;
         other.next = 0;
@@ -174,7 +385,11 @@ void Stash::stashInfo() const
     }
     else
     {
-        cout << static_cast<void*>(storage);
+        cout << static_cast<void*>(storage) << (isInline() ? " (inline)" : "");
+        if (isShared())
+        {
+            cout << " (shared by " << shares->load() << ")";
+        }
     }
     cout << endl;
     cout << "Storage contents: ";
@@ -183,6 +398,10 @@ void Stash::stashInfo() const
         cout << *(int*)(storage + i * size) << " ";
     }
     cout << endl;
+    StashStats current = statistics();
+    cout << "Inflations: " << current.inflations << ", contractions: " << current.contractions << endl;
+    cout << "Bytes copied: " << current.bytesCopied << ", bytes zeroed: " << current.bytesZeroed << endl;
+    cout << "Peak quantity: " << current.peakQuantity << ", utilization: " << current.utilization << endl;
     for(int i = 0; i < 50; ++i)
     {
         cout << "-";
@@ -190,27 +409,61 @@ void Stash::stashInfo() const
     cout << endl;
 }
 
+// Snapshot of the memory usage counters
+StashStats Stash::statistics() const
+{
+    StashStats current = stats;
+    current.utilization = (quantity == 0) ? 0.0 : static_cast<double>(next) / quantity;
+    return current;
+}
+
+// Start counting from the current state
+void Stash::resetStatistics()
+{
+    stats = StashStats();
+    stats.peakQuantity = quantity;
+}
+
 // Clean up the Stash
 void Stash::cleanUp()
 {
     if (storage != nullptr)
     {
-        cout << "Cleaning up Stash..." << endl;
-        delete[] storage;
+        if (verbose)
+        {
+            cout << "Cleaning up Stash..." << endl;
+        }
+        releaseStorage();
         storage = nullptr;
         next = 0;
         quantity = 0;
-        cout << "Stash cleaned up." << endl;
+        if (verbose)
+        {
+            cout << "Stash cleaned up." << endl;
+        }
     }
 }
 
 // Add an element
 int Stash::add(const void* element)
 {
+    // An element of this Stash must be copied out before its storage can move
+    vector<unsigned char> own;
+    if (ownsBytes(element))
+    {
+        const unsigned char* bytes = static_cast<const unsigned char*>(element);
+        own.assign(bytes, bytes + size);
+        element = own.data();
+    }
+
     if (next >= quantity) // Need more space?
     {
         inflate(increment());
     }
+    else
+    {
+        unshare();
+    }
     
     // Copy element into storage at next empty space
     int startBytes = next * size;
@@ -219,11 +472,57 @@ int Stash::add(const void* element)
     memcpy(storage + startBytes, e, size);
     
     ++next;
+    noteOperations(1);
     return (next - 1); // Return index of added element
 }
 
-// Fetch an element
+// Add several contiguous elements, growing at most once
+int Stash::addRange(const void* elements, int count)
+{
+    if (count <= 0)
+    {
+        return next;
+    }
+
+    // A range taken from this Stash must be copied out before its storage can move
+    vector<unsigned char> own;
+    if (ownsBytes(elements))
+    {
+        const unsigned char* bytes = static_cast<const unsigned char*>(elements);
+        own.assign(bytes, bytes + static_cast<size_t>(size) * count);
+        elements = own.data();
+    }
+
+    if (next + count > quantity) // Need more space?
+    {
+        inflate(max(increment(), next + count - quantity));
+    }
+    else
+    {
+        unshare();
+    }
+
+    memcpy(storage + next * size, elements, size * count);
+
+    int first = next;
+    next += count;
+    noteOperations(count);
+    return first; // Return index of the first added element
+}
+
+// Fetch an element; the caller may write through it, so shared storage is copied first
 void* Stash::fetch(int index)
+{
+    if (index < 0 || index >= next) // Check range
+    {
+        throw out_of_range("Stash::fetch(): Index out of range");
+    }
+    unshare();
+    return &(storage[index * size]);
+}
+
+// Fetch an element for reading
+const void* Stash::fetch(int index) const
 {
     if (index < 0 || index >= next) // Check range
     {
@@ -232,6 +531,29 @@ void* Stash::fetch(int index)
     return &(storage[index * size]);
 }
 
+// Typed view over all elements, without per-access bounds checks
+template <typename T>
+StashSpan<T> Stash::view()
+{
+    if (sizeof(T) != static_cast<size_t>(size))
+    {
+        throw invalid_argument("Stash::view(): Type size does not match element size");
+    }
+    unshare();
+    return StashSpan<T>(reinterpret_cast<T*>(storage), next);
+}
+
+// Read-only typed view over all elements
+template <typename T>
+StashSpan<const T> Stash::view() const
+{
+    if (sizeof(T) != static_cast<size_t>(size))
+    {
+        throw invalid_argument("Stash::view(): Type size does not match element size");
+    }
+    return StashSpan<const T>(reinterpret_cast<const T*>(storage), next);
+}
+
 // Increase the size of the array
 void Stash::inflate(int increase)
 {
@@ -240,10 +562,14 @@ void Stash::inflate(int increase)
         return; // No increase needed
     }
     
+    if (increase > INT_MAX - quantity)
+    {
+        throw length_error("Stash::inflate(): Capacity would exceed INT_MAX spaces");
+    }
     int newQuantity = quantity + increase;
     try
     {
-        unsigned char* newStorage = new unsigned char[size * newQuantity];
+        unsigned char* newStorage = allocate(size, newQuantity, policy.alignment);
         
         // Copy existing elements
         if (storage != nullptr)
@@ -255,11 +581,19 @@ void Stash::inflate(int increase)
         memset(newStorage + (size * next), 0, size * (newQuantity - next));
         
         // Replace old storage
-        delete[] storage;
+        releaseStorage();
         storage = newStorage;
         quantity = newQuantity;
-        
-        cout << "Memory inflated. New quantity: " << quantity << endl;
+        trackShares();
+
+        ++stats.inflations;
+        stats.bytesCopied += static_cast<long long>(size) * next;
+        stats.bytesZeroed += static_cast<long long>(size) * (newQuantity - next);
+        stats.peakQuantity = max(stats.peakQuantity, quantity);
+        if (verbose)
+        {
+            cout << "Memory inflated. New quantity: " << quantity << endl;
+        }
     }
     catch(std::bad_alloc&)
     {
@@ -275,9 +609,10 @@ void Stash::remove(int index)
     {
         throw out_of_range("Stash::remove(): Index out of range");
     }
+    unshare();
     
     // Calculate bytes to move down
-    int bytesToMove = (next - index - 1) * size;
+    size_t bytesToMove = static_cast<size_t>(next - index - 1) * size;
     if (bytesToMove > 0)
     {
         memmove(
@@ -285,18 +620,224 @@ void Stash::remove(int index)
             &storage[(index + 1) * size], 
             bytesToMove
         );
+        stats.bytesCopied += bytesToMove;
     }
     
     --next; // Decrease count
-    cout << "Element at index " << index << " removed. New count: " << next << endl;
+    if (verbose)
+    {
+        cout << "Element at index " << index << " removed. New count: " << next << endl;
+    }
     
-    // Consider contracting if storage utilization is low
-    if (next < quantity * 0.3 && quantity > 16) 
+    noteOperations(1);
+    shrinkIfSparse();
+}
+
+// Remove an element without preserving order: the last element fills the hole
+void Stash::removeUnordered(int index)
+{
+    if (index < 0 || index >= next) // Check range
     {
-        contract();
+        throw out_of_range("Stash::removeUnordered(): Index out of range");
+    }
+    unshare();
+
+    int last = next - 1;
+    if (index != last)
+    {
+        memcpy(&storage[index * size], &storage[last * size], size);
+        stats.bytesCopied += size;
+    }
+
+    --next; // Decrease count
+    if (verbose)
+    {
+        cout << "Element at index " << index << " replaced by the last one. New count: " << next << endl;
+    }
+
+    noteOperations(1);
+    shrinkIfSparse();
+}
+
+// Remove the elements at the listed positions
+int Stash::removeMany(const int* indices, int count)
+{
+    // Validate everything before touching the storage
+    vector<bool> doomed(next, false);
+    for (int i = 0; i < count; ++i)
+    {
+        if (indices[i] < 0 || indices[i] >= next)
+        {
+            throw out_of_range("Stash::removeMany(): Index out of range");
+        }
+        doomed[indices[i]] = true;
+    }
+
+    return compact([&doomed](int index, const unsigned char*) { return doomed[index]; });
+}
+
+// Remove every element the predicate accepts
+template <typename Predicate>
+int Stash::removeIf(Predicate pred)
+{
+    return compact([&pred](int, const unsigned char* element)
+    {
+        return pred(static_cast<const void*>(element));
+    });
+}
+
+// Slide survivors down over marked elements in a single pass, then contract once
+template <typename Doomed>
+int Stash::compact(Doomed doomed)
+{
+    unshare();
+
+    int write = 0;
+    int runStart = 0; // First survivor not yet moved into place
+    for (int read = 0; read <= next; ++read)
+    {
+        if (read < next && !doomed(read, storage + read * size))
+        {
+            continue;
+        }
+
+        // Move the whole run of survivors before this hole with one memmove
+        int runLength = read - runStart;
+        if (runLength > 0 && write != runStart)
+        {
+            memmove(&storage[write * size], &storage[runStart * size], runLength * size);
+            stats.bytesCopied += static_cast<long long>(runLength) * size;
+        }
+        write += runLength;
+        runStart = read + 1;
+    }
+
+    int removed = next - write;
+    next = write;
+    noteOperations(removed);
+    if (removed > 0 && verbose)
+    {
+        cout << removed << " elements removed. New count: " << next << endl;
+    }
+
+    shrinkIfSparse();
+    return removed;
+}
+
+// Storage for at least spaces elements: the inline buffer when they fit, it
+// is free and aligned enough, otherwise the heap. spaces grows to fill the
+// whole inline buffer
+unsigned char* Stash::allocate(int sz, int& spaces, int alignment)
+{
+    int inlineSpaces = (sz > 0) ? INLINE_BYTES / sz : 0;
+    if (inlineSpaces > 0 && spaces <= inlineSpaces && storage != inlineBuffer &&
+        alignment <= static_cast<int>(alignof(max_align_t)))
+    {
+        spaces = inlineSpaces;
+        return inlineBuffer;
+    }
+    return alignedAllocate(static_cast<size_t>(sz) * spaces, alignment);
+}
+
+// Drop this Stash's hold on its storage: the inline buffer needs nothing,
+// shared storage is freed by its last owner, anything else is freed now
+void Stash::releaseStorage()
+{
+    if (shares != nullptr)
+    {
+        if (shares->fetch_sub(1) == 1)
+        {
+            alignedFree(storage, policy.alignment);
+            delete shares;
+        }
+        shares = nullptr;
+    }
+    else if (storage != inlineBuffer)
+    {
+        alignedFree(storage, policy.alignment);
+    }
+}
+
+// Pointer lies inside the current storage
+bool Stash::ownsBytes(const void* bytes) const
+{
+    if (storage == nullptr)
+    {
+        return false;
+    }
+    const unsigned char* p = static_cast<const unsigned char*>(bytes);
+    return !less<const unsigned char*>()(p, storage) &&
+           less<const unsigned char*>()(p, storage + static_cast<size_t>(size) * quantity);
+}
+
+// Give copy-on-write heap storage its owner count, so later copies only
+// have to increment it
+void Stash::trackShares()
+{
+    if (copyOnWrite && shares == nullptr && storage != nullptr && !isInline())
+    {
+        shares = new atomic<int>(1);
+    }
+}
+
+// Take a private copy of shared storage before mutating it
+void Stash::unshare()
+{
+    if (shares == nullptr)
+    {
+        return;
+    }
+    if (shares->load() == 1) // Every other copy is gone
+    {
+        return;
+    }
+
+    int spaces = quantity;
+    unsigned char* own = allocate(size, spaces, policy.alignment);
+    memcpy(own, storage, size * next);
+    memset(own + size * next, 0, size * (spaces - next));
+    releaseStorage();
+    storage = own;
+    quantity = spaces;
+    trackShares();
+    stats.bytesCopied += static_cast<long long>(size) * next;
+    stats.bytesZeroed += static_cast<long long>(size) * (spaces - next);
+    if (verbose)
+    {
+        cout << "Shared storage copied on write." << endl;
+    }
+}
+
+// Count adds and removes towards the shrink rules: only operations that leave
+// the Stash sparse add up, and any other operation starts the count again
+void Stash::noteOperations(int ops)
+{
+    if (next < quantity * policy.shrinkThreshold)
+    {
+        quietOps += ops;
+    }
+    else
+    {
+        quietOps = 0;
+    }
+}
+
+// Contract automatically once utilization has stayed low for long enough
+void Stash::shrinkIfSparse()
+{
+    if (next < quantity * policy.shrinkThreshold && quantity > policy.minCapacity &&
+        quietOps >= quantity * policy.shrinkDelay)
+    {
+        contract(policy.shrinkThreshold);
     }
 }
 
+// Contract the storage using the policy threshold
+void Stash::contract()
+{
+    contract(policy.shrinkThreshold);
+}
+
 // Contract the storage
 void Stash::contract(double threshold)
 {
@@ -305,14 +846,14 @@ void Stash::contract(double threshold)
         throw invalid_argument("Stash::contract(): Threshold must be between 0 and 1");
     }
     
-    // Avoid contractions for small containers or when not needed
-    if (quantity <= 16 || next >= quantity * threshold)
+    // Avoid contractions for small or inline containers or when not needed
+    if (quantity <= policy.minCapacity || next >= quantity * threshold || isInline())
     {
         return;
     }
     
-    // Calculate new size, ensuring it can hold existing elements
-    int newQuantity = max(16, next * 2);
+    // Calculate new size, leaving headroom so the next add does not grow right away
+    int newQuantity = max(policy.minCapacity, static_cast<int>(ceil(next / policy.shrinkTarget)));
     if (newQuantity >= quantity)
     {
         return; // No need to contract
@@ -320,14 +861,20 @@ void Stash::contract(double threshold)
     
     try
     {
-        unsigned char* newStorage = new unsigned char[size * newQuantity];
+        unsigned char* newStorage = allocate(size, newQuantity, policy.alignment);
         memcpy(newStorage, storage, size * next);
         
-        delete[] storage;
+        releaseStorage();
         storage = newStorage;
         quantity = newQuantity;
-        
-        cout << "Memory contracted. New quantity: " << quantity << endl;
+        trackShares();
+
+        ++stats.contractions;
+        stats.bytesCopied += static_cast<long long>(size) * next;
+        if (verbose)
+        {
+            cout << "Memory contracted. New quantity: " << quantity << endl;
+        }
     }
     catch(std::bad_alloc&)
     {
@@ -336,52 +883,2743 @@ void Stash::contract(double threshold)
     }
 }
 
-// Test the Stash class
-int main()
+// Sort the elements in place: order an index permutation with less, then
+// walk its cycles so every element is moved exactly once
+template <typename Less>
+void Stash::sort(Less less)
 {
-    // Create a Stash for integers
-    Stash stash(sizeof(int));
-    
-    // Add some integers
-    for (int i = 0; i < 10; ++i)
-    {
-        stash.add(&i);
-    }
-    stash.stashInfo();
-    
-    // Fetch and print elements
-    for (int i = 0; i < stash.count(); ++i)
+    unshare();
+
+    vector<int> order(next);
+    for (int i = 0; i < next; ++i)
     {
-        int* value = static_cast<int*>(stash.fetch(i));
-        cout << "Element at index " << i << ": " << *value << endl;
+        order[i] = i;
     }
-    
-    // Add more elements
-    for (int i = 10; i < 100; ++i)
+    std::sort(order.begin(), order.end(), [this, &less](int a, int b)
     {
-        stash.add(&i);
-    }
-    stash.stashInfo();
+        return less(static_cast<const void*>(storage + a * size), static_cast<const void*>(storage + b * size));
+    });
 
-    // Randomly remove about 80% of elements
-    for(int i = 0; i < stash.count(); ++i)
+    // Position i has to receive the element currently at order[i]
+    vector<unsigned char> held(size);
+    vector<bool> placed(next, false);
+    for (int start = 0; start < next; ++start)
     {
-        if(rand() % 100 < 80)
+        if (placed[start] || order[start] == start)
         {
-            stash.remove(i);
-            --i; // Adjust index after removal
+            continue;
         }
-    }   
-    stash.stashInfo();
 
-    // Clean up
-    stash.cleanUp();
-    stash.stashInfo();
+        memcpy(held.data(), storage + start * size, size);
+        int hole = start;
+        int moves = 2; // Into and out of held
+        while (order[hole] != start)
+        {
+            memcpy(storage + hole * size, storage + order[hole] * size, size);
+            placed[hole] = true;
+            hole = order[hole];
+            ++moves;
+        }
+        memcpy(storage + hole * size, held.data(), size);
+        placed[hole] = true;
+        stats.bytesCopied += static_cast<long long>(size) * moves;
+    }
+}
 
-    // Attempt to fetch after cleanup
-    try
+// First position whose element is not less than key; the Stash must be sorted by less
+template <typename Less>
+int Stash::lowerBound(const void* key, Less less) const
+{
+    int low = 0;
+    int high = next;
+    while (low < high)
     {
-        stash.fetch(0);
+        int middle = low + (high - low) / 2;
+        if (less(static_cast<const void*>(storage + middle * size), key))
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+// Position of an element equal to key, or -1; the Stash must be sorted by less
+template <typename Less>
+int Stash::find(const void* key, Less less) const
+{
+    int position = lowerBound(key, less);
+    if (position < next && !less(key, static_cast<const void*>(storage + position * size)))
+    {
+        return position;
+    }
+    return -1;
+}
+
+// Secondary index over a Stash: element positions ordered by less, so
+// lookups are O(log n) while the Stash keeps its own order. Any change to
+// the Stash makes the index stale until rebuild() is called.
+template <typename Less>
+class StashIndex
+{
+private:
+    const Stash& stash;  // Indexed Stash
+    Less less;           // Element ordering
+    vector<int> order;   // Element positions in ascending order
+
+    const void* element(int rank) const { return stash.fetch(order[rank]); }
+
+public:
+    StashIndex(const Stash& stash, Less less); // Build the index
+    void rebuild(); // Re-sort after the Stash changed
+    int size() const { return static_cast<int>(order.size()); } // Number of indexed elements
+    int at(int rank) const { return order[rank]; } // Position of the rank-th smallest element
+    int lowerBound(const void* key) const; // First rank whose element is not less than key
+    int find(const void* key) const; // Position of an element equal to key, or -1
+}; // StashIndex
+
+// Build the index
+template <typename Less>
+StashIndex<Less>::StashIndex(const Stash& stash, Less less) : stash(stash), less(less)
+{
+    rebuild();
+}
+
+// Re-sort after the Stash changed
+template <typename Less>
+void StashIndex<Less>::rebuild()
+{
+    order.resize(stash.count());
+    for (int i = 0; i < stash.count(); ++i)
+    {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [this](int a, int b)
+    {
+        return less(stash.fetch(a), stash.fetch(b));
+    });
+}
+
+// First rank whose element is not less than key
+template <typename Less>
+int StashIndex<Less>::lowerBound(const void* key) const
+{
+    int low = 0;
+    int high = size();
+    while (low < high)
+    {
+        int middle = low + (high - low) / 2;
+        if (less(element(middle), key))
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+// Position of an element equal to key, or -1
+template <typename Less>
+int StashIndex<Less>::find(const void* key) const
+{
+    int rank = lowerBound(key);
+    if (rank < size() && !less(key, element(rank)))
+    {
+        return order[rank];
+    }
+    return -1;
+}
+
+// Build an index with the comparator type deduced
+template <typename Less>
+StashIndex<Less> makeStashIndex(const Stash& stash, Less less)
+{
+    return StashIndex<Less>(stash, less);
+}
+
+// Header written in front of the elements of a Stash snapshot
+struct StashSnapshotHeader
+{
+    uint32_t magic;     // Identifies a Stash snapshot
+    uint32_t version;   // Snapshot layout version
+    int32_t size;       // Size of each space
+    int32_t count;      // Number of elements that follow
+    uint64_t checksum;  // stashChecksum() of the elements
+};
+
+const uint32_t STASH_SNAPSHOT_MAGIC = 0x48535453; // "STSH"
+const uint32_t STASH_SNAPSHOT_VERSION = 1;
+
+// FNV-1a style hash that consumes eight bytes per step
+uint64_t stashChecksum(const unsigned char* bytes, size_t length)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    size_t i = 0;
+    for (; i + 8 <= length; i += 8)
+    {
+        uint64_t word;
+        memcpy(&word, bytes + i, 8);
+        hash = (hash ^ word) * 1099511628211ULL;
+    }
+    for (; i < length; ++i)
+    {
+        hash = (hash ^ bytes[i]) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+// Write the elements behind a versioned header in one block
+void Stash::save(const string& path) const
+{
+    size_t bytes = static_cast<size_t>(size) * next;
+    StashSnapshotHeader header = {
+        STASH_SNAPSHOT_MAGIC, STASH_SNAPSHOT_VERSION, size, next, stashChecksum(storage, bytes)
+    };
+
+    ofstream file(path, ios::binary | ios::trunc);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(storage), bytes);
+    if (!file)
+    {
+        throw runtime_error("Stash::save(): Cannot write " + path);
+    }
+}
+
+// Read a snapshot straight into a single allocation, without per-element work
+Stash Stash::load(const string& path, const StashPolicy& policy)
+{
+    ifstream file(path, ios::binary);
+    StashSnapshotHeader header;
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)))
+    {
+        throw runtime_error("Stash::load(): Cannot read header of " + path);
+    }
+    if (header.magic != STASH_SNAPSHOT_MAGIC || header.version != STASH_SNAPSHOT_VERSION ||
+        header.size <= 0 || header.count < 0)
+    {
+        throw runtime_error("Stash::load(): " + path + " is not a Stash snapshot");
+    }
+
+    // Check the header against the real file size before trusting it with an allocation
+    streamoff dataStart = file.tellg();
+    file.seekg(0, ios::end);
+    streamoff fileEnd = file.tellg();
+    file.seekg(dataStart);
+    if (dataStart < 0 || fileEnd < dataStart || !file)
+    {
+        throw runtime_error("Stash::load(): Cannot determine the size of " + path);
+    }
+    size_t available = static_cast<size_t>(fileEnd - dataStart);
+    if (static_cast<size_t>(header.count) > SIZE_MAX / static_cast<size_t>(header.size) ||
+        static_cast<size_t>(header.size) * header.count > available)
+    {
+        throw runtime_error("Stash::load(): " + path + " is truncated");
+    }
+
+    Stash stash(header.size, 0, policy);
+    int newQuantity = max(header.count, policy.minCapacity);
+    if (newQuantity > stash.quantity)
+    {
+        // Allocate before releasing, so a failed allocation leaves the Stash intact
+        unsigned char* newStorage = stash.allocate(header.size, newQuantity, policy.alignment);
+        stash.releaseStorage();
+        stash.storage = newStorage;
+        stash.quantity = newQuantity;
+    }
+    size_t bytes = static_cast<size_t>(header.size) * header.count;
+    size_t capacityBytes = static_cast<size_t>(header.size) * stash.quantity;
+
+    if (!file.read(reinterpret_cast<char*>(stash.storage), bytes))
+    {
+        throw runtime_error("Stash::load(): " + path + " is truncated");
+    }
+    if (stashChecksum(stash.storage, bytes) != header.checksum)
+    {
+        throw runtime_error("Stash::load(): Checksum mismatch in " + path);
+    }
+
+    // Only the spare spaces need clearing
+    memset(stash.storage + bytes, 0, capacityBytes - bytes);
+    stash.next = header.count;
+    stash.stats.bytesZeroed = capacityBytes - bytes;
+    stash.stats.peakQuantity = stash.quantity;
+    return stash;
+}
+
+// Typed Stash whose element size is fixed at compile time, so every
+// copy is a fixed-width memcpy the compiler can inline
+template <typename T>
+class TypedStash
+{
+    static_assert(is_trivially_copyable<T>::value, "TypedStash requires a trivially copyable element type");
+
+private:
+    int quantity;  // Number of storage spaces
+    int next;      // Next empty space
+    // Dynamically allocated array of bytes:
+    unsigned char* storage;
+
+    int increment() // Dynamically increase the size of the array by doubling it
+    {
+        return (quantity == 0) ? 1 : quantity;
+    }
+
+public:
+    explicit TypedStash(int initialCapacity = 16); // Constructor
+    ~TypedStash(); // Destructor
+    TypedStash(const TypedStash& other); // Copy constructor
+    TypedStash& operator=(const TypedStash& other); // Copy assignment operator
+    TypedStash(TypedStash&& other) noexcept; // Move constructor
+    TypedStash& operator=(TypedStash&& other) noexcept; // Move assignment operator
+
+    // Member functions
+    void cleanUp(); // Clean up the Stash
+    int add(const T& element); // Add an element
+    T* fetch(int index); // Fetch an element
+    StashSpan<T> view() { return StashSpan<T>(reinterpret_cast<T*>(storage), next); } // View over all elements
+    int count() const { return next; } // Count the number of elements
+    void inflate(int increase); // Increase the size of the array
+    void remove(int index); // Remove an element at specified position
+    void contract(double threshold = 0.3); // Release memory when necessary
+}; // TypedStash
+
+// Constructor
+template <typename T>
+TypedStash<T>::TypedStash(int initialCapacity) :
+    quantity(initialCapacity), next(0)
+{
+    storage = new unsigned char[sizeof(T) * quantity];
+    memset(storage, 0, sizeof(T) * quantity);
+}
+
+// Destructor
+template <typename T>
+TypedStash<T>::~TypedStash()
+{
+    delete[] storage;
+}
+
+// Copy constructor
+template <typename T>
+TypedStash<T>::TypedStash(const TypedStash& other) :
+    quantity(other.quantity), next(other.next)
+{
+    storage = new unsigned char[sizeof(T) * quantity];
+    memcpy(storage, other.storage, sizeof(T) * next);
+}
+
+// Copy assignment operator
+template <typename T>
+TypedStash<T>& TypedStash<T>::operator=(const TypedStash& other)
+{
+    if (this != &other)
+    {
+        unsigned char* newStorage = new unsigned char[sizeof(T) * other.quantity];
+        memcpy(newStorage, other.storage, sizeof(T) * other.next);
+
+        delete[] storage;
+        quantity = other.quantity;
+        next = other.next;
+        storage = newStorage;
+    }
+    return *this;
+}
+
+// Move constructor
+template <typename T>
+TypedStash<T>::TypedStash(TypedStash&& other) noexcept :
+    quantity(other.quantity), next(other.next), storage(other.storage)
+{
+    other.storage = nullptr;
+    other.quantity = 0;
+    other.next = 0;
+}
+
+// Move assignment operator
+template <typename T>
+TypedStash<T>& TypedStash<T>::operator=(TypedStash&& other) noexcept
+{
+    if (this != &other)
+    {
+        delete[] storage;
+
+        quantity = other.quantity;
+        next = other.next;
+        storage = other.storage;
+
+        other.storage = nullptr;
+        other.quantity = 0;
+        other.next = 0;
+    }
+    return *this;
+}
+
+// Clean up the Stash
+template <typename T>
+void TypedStash<T>::cleanUp()
+{
+    delete[] storage;
+    storage = nullptr;
+    next = 0;
+    quantity = 0;
+}
+
+// Add an element
+template <typename T>
+int TypedStash<T>::add(const T& element)
+{
+    if (next >= quantity) // Need more space?
+    {
+        inflate(increment());
+    }
+
+    memcpy(storage + next * sizeof(T), &element, sizeof(T));
+
+    ++next;
+    return (next - 1); // Return index of added element
+}
+
+// Fetch an element
+template <typename T>
+T* TypedStash<T>::fetch(int index)
+{
+    if (index < 0 || index >= next) // Check range
+    {
+        throw out_of_range("TypedStash::fetch(): Index out of range");
+    }
+    return reinterpret_cast<T*>(storage + index * sizeof(T));
+}
+
+// Increase the size of the array
+template <typename T>
+void TypedStash<T>::inflate(int increase)
+{
+    if (increase <= 0)
+    {
+        return; // No increase needed
+    }
+
+    int newQuantity = quantity + increase;
+    unsigned char* newStorage = new unsigned char[sizeof(T) * newQuantity];
+
+    if (storage != nullptr)
+    {
+        memcpy(newStorage, storage, sizeof(T) * next);
+    }
+    memset(newStorage + sizeof(T) * next, 0, sizeof(T) * (newQuantity - next));
+
+    delete[] storage;
+    storage = newStorage;
+    quantity = newQuantity;
+}
+
+// Remove an element at specified position
+template <typename T>
+void TypedStash<T>::remove(int index)
+{
+    if (index < 0 || index >= next) // Check range
+    {
+        throw out_of_range("TypedStash::remove(): Index out of range");
+    }
+
+    int elementsToMove = next - index - 1;
+    if (elementsToMove > 0)
+    {
+        memmove(
+            storage + index * sizeof(T),
+            storage + (index + 1) * sizeof(T),
+            elementsToMove * sizeof(T)
+        );
+    }
+
+    --next;
+
+    if (next < quantity * 0.3 && quantity > 16)
+    {
+        contract();
+    }
+}
+
+// Contract the storage
+template <typename T>
+void TypedStash<T>::contract(double threshold)
+{
+    if (threshold < 0.0 || threshold > 1.0)
+    {
+        throw invalid_argument("TypedStash::contract(): Threshold must be between 0 and 1");
+    }
+
+    if (quantity <= 16 || next >= quantity * threshold)
+    {
+        return;
+    }
+
+    int newQuantity = max(16, next * 2);
+    if (newQuantity >= quantity)
+    {
+        return;
+    }
+
+    try
+    {
+        unsigned char* newStorage = new unsigned char[sizeof(T) * newQuantity];
+        memcpy(newStorage, storage, sizeof(T) * next);
+
+        delete[] storage;
+        storage = newStorage;
+        quantity = newQuantity;
+    }
+    catch(std::bad_alloc&)
+    {
+        // Contract failure is not critical, continue with original storage
+    }
+}
+
+// Compress n bytes with a small LZ77 codec in the style of LZ4. Each
+// sequence is a token (literal length << 4 | match length - 4), extra
+// length bytes when a nibble is 15, the literals, then a 2-byte offset and
+// extra match length bytes. The final sequence has literals only.
+// Returns the compressed size, or 0 when it would not fit in capacity.
+int lzCompress(const unsigned char* src, int n, unsigned char* dst, int capacity)
+{
+    const int MIN_MATCH = 4;
+    const int HASH_BITS = 12;
+    const int MAX_OFFSET = 65535;
+    int table[1 << HASH_BITS]; // Last position seen for each 4-byte hash
+    fill(table, table + (1 << HASH_BITS), -1);
+
+    int out = 0;
+    auto put = [&](unsigned char byte) -> bool
+    {
+        if (out >= capacity)
+        {
+            return false;
+        }
+        dst[out++] = byte;
+        return true;
+    };
+    auto putLength = [&](int length) -> bool // Extra bytes of a nibble that reached 15
+    {
+        for (; length >= 255; length -= 255)
+        {
+            if (!put(255))
+            {
+                return false;
+            }
+        }
+        return put(static_cast<unsigned char>(length));
+    };
+    auto putSequence = [&](int literalStart, int literalLength, int offset, int matchLength) -> bool
+    {
+        int matchCode = (matchLength == 0) ? 0 : matchLength - MIN_MATCH;
+        if (!put(static_cast<unsigned char>((min(literalLength, 15) << 4) | min(matchCode, 15))))
+        {
+            return false;
+        }
+        if (literalLength >= 15 && !putLength(literalLength - 15))
+        {
+            return false;
+        }
+        if (out + literalLength > capacity)
+        {
+            return false;
+        }
+        memcpy(dst + out, src + literalStart, literalLength);
+        out += literalLength;
+        if (matchLength == 0)
+        {
+            return true; // Final sequence
+        }
+        if (!put(static_cast<unsigned char>(offset & 0xFF)) || !put(static_cast<unsigned char>(offset >> 8)))
+        {
+            return false;
+        }
+        return matchCode < 15 || putLength(matchCode - 15);
+    };
+
+    int anchor = 0; // First byte not yet emitted
+    int i = 0;
+    while (i + MIN_MATCH <= n)
+    {
+        uint32_t sequence;
+        memcpy(&sequence, src + i, 4);
+        int hash = static_cast<int>((sequence * 2654435761u) >> (32 - HASH_BITS));
+        int candidate = table[hash];
+        table[hash] = i;
+        if (candidate < 0 || i - candidate > MAX_OFFSET || memcmp(src + candidate, src + i, MIN_MATCH) != 0)
+        {
+            ++i;
+            continue;
+        }
+
+        int matchLength = MIN_MATCH;
+        while (i + matchLength < n && src[candidate + matchLength] == src[i + matchLength])
+        {
+            ++matchLength;
+        }
+        if (!putSequence(anchor, i - anchor, i - candidate, matchLength))
+        {
+            return 0;
+        }
+        i += matchLength;
+        anchor = i;
+    }
+
+    if (!putSequence(anchor, n - anchor, 0, 0))
+    {
+        return 0;
+    }
+    return out;
+}
+
+// Decompress what lzCompress produced; returns the decoded size, or -1 if the input is corrupt
+int lzDecompress(const unsigned char* src, int n, unsigned char* dst, int capacity)
+{
+    int in = 0;
+    int out = 0;
+    auto getLength = [&](int length) -> int // Add the extra bytes of a nibble that reached 15
+    {
+        unsigned char byte = 255;
+        while (byte == 255 && in < n)
+        {
+            byte = src[in++];
+            length += byte;
+        }
+        return length;
+    };
+
+    while (in < n)
+    {
+        unsigned char token = src[in++];
+        int literalLength = token >> 4;
+        if (literalLength == 15)
+        {
+            literalLength = getLength(literalLength);
+        }
+        if (in + literalLength > n || out + literalLength > capacity)
+        {
+            return -1;
+        }
+        memcpy(dst + out, src + in, literalLength);
+        in += literalLength;
+        out += literalLength;
+        if (in == n)
+        {
+            break; // Final sequence carries no match
+        }
+
+        if (in + 2 > n)
+        {
+            return -1;
+        }
+        int offset = src[in] | (src[in + 1] << 8);
+        in += 2;
+        int matchLength = token & 0x0F;
+        if (matchLength == 15)
+        {
+            matchLength = getLength(matchLength);
+        }
+        matchLength += 4;
+        if (offset == 0 || offset > out || out + matchLength > capacity)
+        {
+            return -1;
+        }
+        for (int k = 0; k < matchLength; ++k) // Byte by byte, the match may overlap itself
+        {
+            dst[out + k] = dst[out - offset + k];
+        }
+        out += matchLength;
+    }
+    return out;
+}
+
+// Counters for the cold-block compression of a SegmentedStash
+struct CompressionStats
+{
+    long long blocksCompressed = 0; // Blocks packed by compressCold()
+    long long blocksThawed = 0;     // Cold blocks unpacked for writing
+    long long cacheHits = 0;        // Reads of cold blocks served by the decoded-block cache
+    long long cacheMisses = 0;      // Reads of cold blocks that had to be decoded
+    long long bytesDecoded = 0;     // Bytes produced by decompression
+    long long residentBytes = 0;    // Bytes held right now by blocks, packed blocks and the cache
+};
+
+// Stash split into fixed-size blocks reached through a directory. Growing
+// only appends blocks, so elements are never copied on add() and pointers
+// returned by fetch() stay valid until the element is removed or its
+// block is compressed. Full blocks that have not been fetched recently can
+// be compressed; reading them through the const fetch() decodes into a
+// small cache, writing through the non-const fetch() thaws them until the
+// next compressCold() pass. Callers either drive compressCold() themselves
+// or let compressEvery() run it from the non-const fetch() on a schedule.
+class SegmentedStash
+{
+private:
+    struct Block
+    {
+        unsigned char* data;   // Spaces of a hot block, nullptr while compressed
+        unsigned char* packed; // Compressed spaces of a cold block
+        int packedSize;        // Bytes in packed
+        long long lastUse;     // Fetch tick of the latest access
+    };
+
+    static const int CACHE_SLOTS = 4;
+    struct CacheSlot
+    {
+        int block;             // Decoded block, -1 when empty
+        long long lastUse;     // Fetch tick of the latest hit
+        unsigned char* data;   // Decoded spaces
+    };
+
+    int size;           // Size of each space
+    int blockCapacity;  // Number of spaces in each block
+    int blockCount;     // Number of allocated blocks
+    int directorySize;  // Number of slots in the block directory
+    int next;           // Next empty space
+    Block* blocks;      // Directory of blocks
+    mutable long long tick;              // Fetch counter used to age blocks
+    mutable CacheSlot cache[CACHE_SLOTS]; // Recently decoded cold blocks
+    mutable CompressionStats stats;      // Compression counters
+    long long compressInterval; // Fetches between automatic compressCold() passes, 0 when the caller drives them
+    long long compressIdle;     // idleFetches handed to the automatic passes
+    long long nextCompress;     // Fetch tick of the next automatic pass
+
+    void growDirectory(int minSize); // Make room for more block pointers
+    int blockBytes() const { return blockCapacity * size; }
+    void thaw(int block); // Decompress a cold block back into place
+    bool freeze(int block, unsigned char* buffer); // Compress a hot block in place, false if it does not shrink
+    void freeBlock(int block); // Release the memory of one block
+    void dropCached(int block) const; // Forget a decoded copy of a block
+    const unsigned char* decoded(int block) const; // Spaces of a cold block through the cache
+    unsigned char* slot(int index) const // Address of a space in a hot block
+    {
+        return blocks[index / blockCapacity].data + (index % blockCapacity) * size;
+    }
+
+public:
+    SegmentedStash(int sz, int blockCapacity = 64); // Constructor
+    ~SegmentedStash(); // Destructor
+    SegmentedStash(const SegmentedStash& other); // Copy constructor
+    SegmentedStash& operator=(const SegmentedStash& other); // Copy assignment operator
+    SegmentedStash(SegmentedStash&& other) noexcept; // Move constructor
+    SegmentedStash& operator=(SegmentedStash&& other) noexcept; // Move assignment operator
+
+    // Member functions
+    void cleanUp(); // Clean up the Stash
+    int add(const void* element); // Add an element
+    void* fetch(int index); // Fetch an element for writing, thawing a cold block
+    const void* fetch(int index) const; // Fetch an element for reading, valid until the next read of a cold block
+    int count() const { return next; } // Count the number of elements
+    int capacity() const { return blockCount * blockCapacity; } // Number of allocated spaces
+    void inflate(int increase); // Append enough blocks for at least increase more spaces
+    void remove(int index); // Remove an element at specified position
+    void contract(double threshold = 0.3); // Release trailing blocks when necessary
+    int compressCold(long long idleFetches); // Compress full blocks not fetched within idleFetches fetches
+    void compressEvery(long long interval, long long idleFetches); // Run compressCold() every interval fetches, 0 to stop
+    CompressionStats compressionStatistics() const; // Snapshot of the compression counters
+}; // SegmentedStash
+
+// Constructor
+SegmentedStash::SegmentedStash(int sz, int blockCapacity) :
+    size(sz), blockCapacity(blockCapacity), blockCount(0), directorySize(0), next(0), blocks(nullptr), tick(0),
+    compressInterval(0), compressIdle(0), nextCompress(0)
+{
+    if (sz <= 0 || blockCapacity <= 0)
+    {
+        throw invalid_argument("SegmentedStash: Element size and block capacity must be positive");
+    }
+    for (CacheSlot& entry : cache)
+    {
+        entry = CacheSlot{-1, 0, nullptr};
+    }
+}
+
+// Destructor
+SegmentedStash::~SegmentedStash()
+{
+    cleanUp();
+}
+
+// Copy constructor
+SegmentedStash::SegmentedStash(const SegmentedStash& other) :
+    size(other.size), blockCapacity(other.blockCapacity), blockCount(0), directorySize(0), next(0),
+    blocks(nullptr), tick(0), compressInterval(0), compressIdle(0), nextCompress(0)
+{
+    for (CacheSlot& entry : cache)
+    {
+        entry = CacheSlot{-1, 0, nullptr};
+    }
+    *this = other;
+}
+
+// Copy assignment operator; cold blocks are copied still compressed
+SegmentedStash& SegmentedStash::operator=(const SegmentedStash& other)
+{
+    if (this != &other)
+    {
+        SegmentedStash copy(other.size, other.blockCapacity);
+        copy.inflate(other.next);
+        for (int b = 0; b * other.blockCapacity < other.next; ++b)
+        {
+            const Block& source = other.blocks[b];
+            if (source.data == nullptr)
+            {
+                delete[] copy.blocks[b].data;
+                copy.blocks[b].data = nullptr;
+                copy.blocks[b].packed = new unsigned char[source.packedSize];
+                copy.blocks[b].packedSize = source.packedSize;
+                memcpy(copy.blocks[b].packed, source.packed, source.packedSize);
+                continue;
+            }
+            int elements = min(other.blockCapacity, other.next - b * other.blockCapacity);
+            memcpy(copy.blocks[b].data, source.data, elements * other.size);
+        }
+        copy.next = other.next;
+        copy.compressInterval = other.compressInterval;
+        copy.compressIdle = other.compressIdle;
+        copy.nextCompress = other.nextCompress - other.tick;
+
+        *this = std::move(copy);
+    }
+    return *this;
+}
+
+// Move constructor
+SegmentedStash::SegmentedStash(SegmentedStash&& other) noexcept :
+    size(other.size), blockCapacity(other.blockCapacity), blockCount(other.blockCount),
+    directorySize(other.directorySize), next(other.next), blocks(other.blocks), tick(other.tick),
+    stats(other.stats), compressInterval(other.compressInterval), compressIdle(other.compressIdle),
+    nextCompress(other.nextCompress)
+{
+    for (int c = 0; c < CACHE_SLOTS; ++c)
+    {
+        cache[c] = other.cache[c];
+        other.cache[c] = CacheSlot{-1, 0, nullptr};
+    }
+    other.blocks = nullptr;
+    other.blockCount = 0;
+    other.directorySize = 0;
+    other.next = 0;
+}
+
+// Move assignment operator
+SegmentedStash& SegmentedStash::operator=(SegmentedStash&& other) noexcept
+{
+    if (this != &other)
+    {
+        cleanUp();
+
+        size = other.size;
+        blockCapacity = other.blockCapacity;
+        blockCount = other.blockCount;
+        directorySize = other.directorySize;
+        next = other.next;
+        blocks = other.blocks;
+        tick = other.tick;
+        stats = other.stats;
+        compressInterval = other.compressInterval;
+        compressIdle = other.compressIdle;
+        nextCompress = other.nextCompress;
+        for (int c = 0; c < CACHE_SLOTS; ++c)
+        {
+            cache[c] = other.cache[c];
+            other.cache[c] = CacheSlot{-1, 0, nullptr};
+        }
+
+        other.blocks = nullptr;
+        other.blockCount = 0;
+        other.directorySize = 0;
+        other.next = 0;
+    }
+    return *this;
+}
+
+// Clean up the Stash
+void SegmentedStash::cleanUp()
+{
+    for (int b = 0; b < blockCount; ++b)
+    {
+        freeBlock(b);
+    }
+    for (CacheSlot& entry : cache)
+    {
+        delete[] entry.data;
+        entry = CacheSlot{-1, 0, nullptr};
+    }
+    delete[] blocks;
+    blocks = nullptr;
+    blockCount = 0;
+    directorySize = 0;
+    next = 0;
+}
+
+// Make room for more block pointers; only the directory is copied, never the elements
+void SegmentedStash::growDirectory(int minSize)
+{
+    int newSize = max(minSize, directorySize == 0 ? 4 : directorySize * 2);
+    Block* newBlocks = new Block[newSize];
+    if (blocks != nullptr)
+    {
+        memcpy(newBlocks, blocks, blockCount * sizeof(Block));
+    }
+    delete[] blocks;
+    blocks = newBlocks;
+    directorySize = newSize;
+}
+
+// Release the memory of one block
+void SegmentedStash::freeBlock(int block)
+{
+    delete[] blocks[block].data;
+    delete[] blocks[block].packed;
+    blocks[block].data = nullptr;
+    blocks[block].packed = nullptr;
+    dropCached(block);
+}
+
+// Forget a decoded copy of a block
+void SegmentedStash::dropCached(int block) const
+{
+    for (CacheSlot& entry : cache)
+    {
+        if (entry.block == block)
+        {
+            entry.block = -1;
+        }
+    }
+}
+
+// Decompress a cold block back into place
+void SegmentedStash::thaw(int block)
+{
+    Block& target = blocks[block];
+    if (target.data != nullptr)
+    {
+        return; // Already hot
+    }
+
+    unsigned char* data = new unsigned char[blockBytes()];
+    int decodedBytes = lzDecompress(target.packed, target.packedSize, data, blockBytes());
+    if (decodedBytes != blockBytes())
+    {
+        delete[] data;
+        throw runtime_error("SegmentedStash: Corrupt compressed block");
+    }
+    delete[] target.packed;
+    target.packed = nullptr;
+    target.data = data;
+    dropCached(block);
+    ++stats.blocksThawed;
+    stats.bytesDecoded += decodedBytes;
+}
+
+// Spaces of a cold block, decoded into the least recently used cache slot on a miss
+const unsigned char* SegmentedStash::decoded(int block) const
+{
+    CacheSlot* victim = &cache[0];
+    for (CacheSlot& entry : cache)
+    {
+        if (entry.block == block)
+        {
+            ++stats.cacheHits;
+            entry.lastUse = tick;
+            return entry.data;
+        }
+        if (entry.block == -1 || (victim->block != -1 && entry.lastUse < victim->lastUse))
+        {
+            victim = &entry;
+        }
+    }
+
+    ++stats.cacheMisses;
+    if (victim->data == nullptr)
+    {
+        victim->data = new unsigned char[blockBytes()];
+    }
+    const Block& source = blocks[block];
+    int decodedBytes = lzDecompress(source.packed, source.packedSize, victim->data, blockBytes());
+    if (decodedBytes != blockBytes())
+    {
+        victim->block = -1;
+        throw runtime_error("SegmentedStash: Corrupt compressed block");
+    }
+    stats.bytesDecoded += decodedBytes;
+    victim->block = block;
+    victim->lastUse = tick;
+    return victim->data;
+}
+
+// Add an element
+int SegmentedStash::add(const void* element)
+{
+    if (next >= capacity()) // Need more space?
+    {
+        inflate(1);
+    }
+
+    int block = next / blockCapacity;
+    thaw(block);
+    memcpy(slot(next), element, size);
+
+    ++next;
+    return (next - 1); // Return index of added element
+}
+
+// Fetch an element for writing; a cold block is thawed, so the pointer stays
+// valid until the block goes cold again. A due automatic pass runs first, so
+// it never packs the block being returned
+void* SegmentedStash::fetch(int index)
+{
+    if (index < 0 || index >= next) // Check range
+    {
+        throw out_of_range("SegmentedStash::fetch(): Index out of range");
+    }
+    int block = index / blockCapacity;
+    ++tick;
+    if (compressInterval > 0 && tick >= nextCompress)
+    {
+        nextCompress = tick + compressInterval;
+        compressCold(compressIdle);
+    }
+    thaw(block);
+    blocks[block].lastUse = tick;
+    return slot(index);
+}
+
+// Fetch an element for reading; a cold block is served from the decoded-block cache
+const void* SegmentedStash::fetch(int index) const
+{
+    if (index < 0 || index >= next) // Check range
+    {
+        throw out_of_range("SegmentedStash::fetch(): Index out of range");
+    }
+    int block = index / blockCapacity;
+    blocks[block].lastUse = ++tick;
+    if (blocks[block].data != nullptr)
+    {
+        return slot(index);
+    }
+    return decoded(block) + (index % blockCapacity) * size;
+}
+
+// Append enough zeroed blocks for at least increase more spaces
+void SegmentedStash::inflate(int increase)
+{
+    if (increase <= 0)
+    {
+        return; // No increase needed
+    }
+
+    int newBlockCount = (next + increase + blockCapacity - 1) / blockCapacity;
+    if (newBlockCount <= blockCount)
+    {
+        return; // Enough spare space already
+    }
+    if (newBlockCount > directorySize)
+    {
+        growDirectory(newBlockCount);
+    }
+    while (blockCount < newBlockCount)
+    {
+        blocks[blockCount] = Block{new unsigned char[blockBytes()](), nullptr, 0, tick};
+        ++blockCount;
+    }
+}
+
+// Remove an element at specified position, shifting the following elements
+// across blocks. Blocks that were cold are packed again after the shift, so a
+// remove near the front does not leave the whole tail decompressed
+void SegmentedStash::remove(int index)
+{
+    if (index < 0 || index >= next) // Check range
+    {
+        throw out_of_range("SegmentedStash::remove(): Index out of range");
+    }
+
+    int block = index / blockCapacity;
+    int offset = index % blockCapacity;
+    int firstBlock = block;
+    int lastBlock = (next - 1) / blockCapacity;
+    vector<bool> wasCold(lastBlock - firstBlock + 1);
+    for (int b = block; b <= lastBlock; ++b)
+    {
+        wasCold[b - firstBlock] = blocks[b].data == nullptr;
+        thaw(b); // Every block from here on is rewritten
+    }
+    while (block <= lastBlock)
+    {
+        // Shift the rest of this block down by one space
+        int end = (block == lastBlock) ? (next - 1) % blockCapacity + 1 : blockCapacity;
+        memmove(blocks[block].data + offset * size, blocks[block].data + (offset + 1) * size, (end - offset - 1) * size);
+
+        // Pull the first element of the next block into the freed last space
+        if (block < lastBlock)
+        {
+            memcpy(blocks[block].data + (blockCapacity - 1) * size, blocks[block + 1].data, size);
+        }
+        ++block;
+        offset = 0;
+    }
+
+    --next; // Decrease count
+
+    // Re-pack the blocks that were cold and are still full
+    vector<unsigned char> buffer;
+    for (int b = firstBlock; b <= lastBlock && (b + 1) * blockCapacity <= next; ++b)
+    {
+        if (!wasCold[b - firstBlock])
+        {
+            continue;
+        }
+        try
+        {
+            buffer.resize(blockBytes());
+            freeze(b, buffer.data());
+        }
+        catch (const bad_alloc&)
+        {
+            break; // The element is removed; the rest simply stay hot
+        }
+    }
+
+    // Consider contracting if storage utilization is low
+    if (next < capacity() * 0.3 && blockCount > 1)
+    {
+        contract();
+    }
+}
+
+// Release trailing blocks, keeping one spare block beyond the elements in use
+void SegmentedStash::contract(double threshold)
+{
+    if (threshold < 0.0 || threshold > 1.0)
+    {
+        throw invalid_argument("SegmentedStash::contract(): Threshold must be between 0 and 1");
+    }
+
+    if (next >= capacity() * threshold)
+    {
+        return;
+    }
+
+    int keepBlocks = (next + blockCapacity - 1) / blockCapacity + 1;
+    while (blockCount > keepBlocks)
+    {
+        --blockCount;
+        freeBlock(blockCount);
+    }
+}
+
+// Compress full blocks not fetched within the last idleFetches fetches; blocks
+// that do not shrink stay hot. Returns the number of blocks compressed
+int SegmentedStash::compressCold(long long idleFetches)
+{
+    vector<unsigned char> buffer(blockBytes());
+    int compressed = 0;
+    for (int b = 0; (b + 1) * blockCapacity <= next; ++b)
+    {
+        if (blocks[b].data == nullptr || tick - blocks[b].lastUse < idleFetches)
+        {
+            continue; // Already cold, or still in use
+        }
+        compressed += freeze(b, buffer.data()) ? 1 : 0;
+    }
+    return compressed;
+}
+
+// Compress a hot block in place through buffer, which holds blockBytes();
+// an incompressible block stays hot
+bool SegmentedStash::freeze(int block, unsigned char* buffer)
+{
+    Block& target = blocks[block];
+    int packedSize = lzCompress(target.data, blockBytes(), buffer, blockBytes() - 1);
+    if (packedSize == 0)
+    {
+        return false;
+    }
+    target.packed = new unsigned char[packedSize];
+    memcpy(target.packed, buffer, packedSize);
+    target.packedSize = packedSize;
+    delete[] target.data;
+    target.data = nullptr;
+    ++stats.blocksCompressed;
+    return true;
+}
+
+// Re-freeze thawed and newly filled blocks from the non-const fetch(): every
+// interval fetches, blocks idle for idleFetches fetches are compressed again
+void SegmentedStash::compressEvery(long long interval, long long idleFetches)
+{
+    if (interval < 0 || idleFetches < 1)
+    {
+        throw invalid_argument("SegmentedStash::compressEvery(): Interval must not be negative and idleFetches must be positive");
+    }
+    compressInterval = interval;
+    compressIdle = idleFetches;
+    nextCompress = tick + interval;
+}
+
+// Snapshot of the compression counters, with the resident memory added up now
+CompressionStats SegmentedStash::compressionStatistics() const
+{
+    CompressionStats current = stats;
+    current.residentBytes = static_cast<long long>(directorySize) * sizeof(Block);
+    for (int b = 0; b < blockCount; ++b)
+    {
+        current.residentBytes += (blocks[b].data != nullptr) ? blockBytes() : blocks[b].packedSize;
+    }
+    for (const CacheSlot& entry : cache)
+    {
+        current.residentBytes += (entry.data != nullptr) ? blockBytes() : 0;
+    }
+    return current;
+}
+
+// Field of a fixed record schema: where it sits in a record and how wide it is
+struct StashField
+{
+    int offset;  // Byte offset inside a record
+    int size;    // Width in bytes
+};
+
+// Stash laid out structure-of-arrays: each field of the record schema is
+// kept in its own contiguous, aligned column, so a scan over one field only
+// pulls that field through the cache. add() scatters a record into the
+// columns and fetch() gathers it back.
+class ColumnStash
+{
+private:
+    vector<StashField> schema;       // Fields of a record
+    int recordSize;                  // Size of a whole record
+    int alignment;                   // Byte alignment of every column
+    int quantity;                    // Number of storage spaces per column
+    int next;                        // Next empty space
+    vector<unsigned char*> columns;  // One block of storage per field
+
+    void reallocate(int newQuantity); // Move every column into storage of a new size
+
+public:
+    ColumnStash(const vector<StashField>& schema, int recordSize, int initialCapacity = 16, int alignment = 64); // Constructor
+    ~ColumnStash(); // Destructor
+    ColumnStash(const ColumnStash& other); // Copy constructor
+    ColumnStash& operator=(const ColumnStash& other); // Copy assignment operator
+    ColumnStash(ColumnStash&& other) noexcept; // Move constructor
+    ColumnStash& operator=(ColumnStash&& other) noexcept; // Move assignment operator
+
+    // Member functions
+    void cleanUp(); // Clean up the Stash
+    int add(const void* record); // Scatter a record into the columns
+    void fetch(int index, void* record) const; // Gather a record from the columns
+    void* field(int index, int column); // Address of one field of one record
+    template <typename T>
+    StashSpan<T> column(int column); // Typed view over a whole column
+    int count() const { return next; } // Count the number of records
+    int fieldCount() const { return static_cast<int>(schema.size()); } // Number of columns
+    void inflate(int increase); // Increase the size of every column
+    void remove(int index); // Remove a record at specified position
+    void contract(double threshold = 0.3); // Release memory when necessary
+}; // ColumnStash
+
+// Constructor
+ColumnStash::ColumnStash(const vector<StashField>& schema, int recordSize, int initialCapacity, int alignment) :
+    schema(schema), recordSize(recordSize), alignment(alignment), quantity(0), next(0), columns(schema.size(), nullptr)
+{
+    if (alignment < 0 || (alignment & (alignment - 1)) != 0)
+    {
+        throw invalid_argument("ColumnStash: Alignment must be 0 or a power of two");
+    }
+    for (const StashField& f : schema)
+    {
+        if (f.size <= 0 || f.offset < 0 || f.offset + f.size > recordSize)
+        {
+            throw invalid_argument("ColumnStash: Field lies outside the record");
+        }
+    }
+    inflate(initialCapacity);
+}
+
+// Destructor
+ColumnStash::~ColumnStash()
+{
+    cleanUp();
+}
+
+// Copy constructor
+ColumnStash::ColumnStash(const ColumnStash& other) :
+    schema(other.schema), recordSize(other.recordSize), alignment(other.alignment),
+    quantity(0), next(0), columns(other.schema.size(), nullptr)
+{
+    reallocate(other.quantity);
+    for (size_t c = 0; c < columns.size(); ++c)
+    {
+        memcpy(columns[c], other.columns[c], static_cast<size_t>(schema[c].size) * other.next);
+    }
+    next = other.next;
+}
+
+// Copy assignment operator
+ColumnStash& ColumnStash::operator=(const ColumnStash& other)
+{
+    if (this != &other)
+    {
+        ColumnStash copy(other);
+        *this = std::move(copy);
+    }
+    return *this;
+}
+
+// Move constructor
+ColumnStash::ColumnStash(ColumnStash&& other) noexcept :
+    schema(std::move(other.schema)), recordSize(other.recordSize), alignment(other.alignment),
+    quantity(other.quantity), next(other.next), columns(std::move(other.columns))
+{
+    other.columns.clear();
+    other.quantity = 0;
+    other.next = 0;
+}
+
+// Move assignment operator
+ColumnStash& ColumnStash::operator=(ColumnStash&& other) noexcept
+{
+    if (this != &other)
+    {
+        cleanUp();
+
+        schema = std::move(other.schema);
+        recordSize = other.recordSize;
+        alignment = other.alignment;
+        quantity = other.quantity;
+        next = other.next;
+        columns = std::move(other.columns);
+
+        other.columns.clear();
+        other.quantity = 0;
+        other.next = 0;
+    }
+    return *this;
+}
+
+// Clean up the Stash
+void ColumnStash::cleanUp()
+{
+    for (size_t c = 0; c < columns.size(); ++c)
+    {
+        alignedFree(columns[c], alignment);
+        columns[c] = nullptr;
+    }
+    quantity = 0;
+    next = 0;
+}
+
+// Move every column into zeroed, aligned storage of a new size
+void ColumnStash::reallocate(int newQuantity)
+{
+    vector<unsigned char*> newColumns(columns.size(), nullptr);
+    try
+    {
+        for (size_t c = 0; c < columns.size(); ++c)
+        {
+            newColumns[c] = alignedAllocate(static_cast<size_t>(schema[c].size) * newQuantity, alignment);
+        }
+    }
+    catch (std::bad_alloc&)
+    {
+        for (unsigned char* column : newColumns)
+        {
+            alignedFree(column, alignment);
+        }
+        throw;
+    }
+
+    for (size_t c = 0; c < columns.size(); ++c)
+    {
+        size_t used = static_cast<size_t>(schema[c].size) * next;
+        size_t total = static_cast<size_t>(schema[c].size) * newQuantity;
+        if (columns[c] != nullptr)
+        {
+            memcpy(newColumns[c], columns[c], used);
+        }
+        memset(newColumns[c] + used, 0, total - used);
+        alignedFree(columns[c], alignment);
+        columns[c] = newColumns[c];
+    }
+    quantity = newQuantity;
+}
+
+// Scatter a record into the columns
+int ColumnStash::add(const void* record)
+{
+    if (next >= quantity) // Need more space?
+    {
+        inflate(max(1, quantity));
+    }
+
+    const unsigned char* bytes = static_cast<const unsigned char*>(record);
+    for (size_t c = 0; c < columns.size(); ++c)
+    {
+        memcpy(columns[c] + static_cast<size_t>(schema[c].size) * next, bytes + schema[c].offset, schema[c].size);
+    }
+
+    ++next;
+    return (next - 1); // Return index of added record
+}
+
+// Gather a record from the columns; bytes outside every field are left untouched
+void ColumnStash::fetch(int index, void* record) const
+{
+    if (index < 0 || index >= next) // Check range
+    {
+        throw out_of_range("ColumnStash::fetch(): Index out of range");
+    }
+
+    unsigned char* bytes = static_cast<unsigned char*>(record);
+    for (size_t c = 0; c < columns.size(); ++c)
+    {
+        memcpy(bytes + schema[c].offset, columns[c] + static_cast<size_t>(schema[c].size) * index, schema[c].size);
+    }
+}
+
+// Address of one field of one record
+void* ColumnStash::field(int index, int column)
+{
+    if (index < 0 || index >= next || column < 0 || column >= fieldCount()) // Check range
+    {
+        throw out_of_range("ColumnStash::field(): Index out of range");
+    }
+    return columns[column] + static_cast<size_t>(schema[column].size) * index;
+}
+
+// Typed view over a whole column
+template <typename T>
+StashSpan<T> ColumnStash::column(int column)
+{
+    if (column < 0 || column >= fieldCount())
+    {
+        throw out_of_range("ColumnStash::column(): Column out of range");
+    }
+    if (sizeof(T) != static_cast<size_t>(schema[column].size))
+    {
+        throw invalid_argument("ColumnStash::column(): Type size does not match field size");
+    }
+    return StashSpan<T>(reinterpret_cast<T*>(columns[column]), next);
+}
+
+// Increase the size of every column
+void ColumnStash::inflate(int increase)
+{
+    if (increase <= 0)
+    {
+        return; // No increase needed
+    }
+    reallocate(quantity + increase);
+}
+
+// Remove a record at specified position
+void ColumnStash::remove(int index)
+{
+    if (index < 0 || index >= next) // Check range
+    {
+        throw out_of_range("ColumnStash::remove(): Index out of range");
+    }
+
+    for (size_t c = 0; c < columns.size(); ++c)
+    {
+        size_t width = schema[c].size;
+        memmove(columns[c] + width * index, columns[c] + width * (index + 1), width * (next - index - 1));
+    }
+    --next;
+
+    // Consider contracting if storage utilization is low
+    if (next < quantity * 0.3 && quantity > 16)
+    {
+        contract();
+    }
+}
+
+// Release memory when necessary
+void ColumnStash::contract(double threshold)
+{
+    if (threshold < 0.0 || threshold > 1.0)
+    {
+        throw invalid_argument("ColumnStash::contract(): Threshold must be between 0 and 1");
+    }
+
+    if (quantity <= 16 || next >= quantity * threshold)
+    {
+        return;
+    }
+
+    int newQuantity = max(16, next * 2);
+    if (newQuantity < quantity)
+    {
+        reallocate(newQuantity);
+    }
+}
+
+// Append-only Stash that several threads can add() to at once, lock-free.
+// Each add() reserves its space with one compare-and-swap on next, blocks are
+// installed with a single compare-and-swap, and a per-space flag publishes
+// the element so fetch() never observes a half-written copy. The add() that
+// fills half of block b installs block b + 1 ahead of need, so threads rarely
+// race to build the same block. Block b holds firstBlockCapacity << b
+// spaces, so the directory never has to move.
+class ConcurrentStash
+{
+private:
+    static const int MAX_BLOCKS = 32;
+
+    struct Block
+    {
+        unsigned char* data;              // Spaces of this block
+        atomic<unsigned char>* published; // Set once a space has been written
+
+        explicit Block(size_t bytes, size_t spaces) :
+            data(new unsigned char[bytes]), published(new atomic<unsigned char>[spaces]())
+        {
+        }
+        ~Block()
+        {
+            delete[] data;
+            delete[] published;
+        }
+    };
+
+    int size;            // Size of each space
+    int firstBlockShift; // log2 of the number of spaces in block 0
+    int capacity;        // Spaces the whole directory can hold, at most INT_MAX
+    atomic<int> next;    // Next space to reserve
+    atomic<Block*> blocks[MAX_BLOCKS]; // Directory of lazily installed blocks
+
+    void locate(int index, int& block, int& offset) const; // Map an index to its block and offset
+    Block* ensureBlock(int block); // Install a block if no thread has yet
+
+public:
+    ConcurrentStash(int sz, int firstBlockCapacity = 64); // Constructor
+    ~ConcurrentStash(); // Destructor
+    ConcurrentStash(const ConcurrentStash&) = delete;
+    ConcurrentStash& operator=(const ConcurrentStash&) = delete;
+
+    // Member functions, all safe to call concurrently
+    int add(const void* element); // Add an element
+    void* fetch(int index); // Fetch an element, nullptr while it is still being written
+    int count() const { return min(next.load(memory_order_acquire), capacity); } // Number of reserved spaces
+}; // ConcurrentStash
+
+// Constructor; the first block capacity is rounded up to a power of two
+ConcurrentStash::ConcurrentStash(int sz, int firstBlockCapacity) :
+    size(sz), firstBlockShift(0), capacity(0), next(0)
+{
+    if (sz <= 0 || firstBlockCapacity <= 0)
+    {
+        throw invalid_argument("ConcurrentStash: Element size and block capacity must be positive");
+    }
+    while ((1 << firstBlockShift) < firstBlockCapacity && firstBlockShift < 20)
+    {
+        ++firstBlockShift;
+    }
+    for (int b = 0; b < MAX_BLOCKS; ++b)
+    {
+        blocks[b].store(nullptr, memory_order_relaxed);
+    }
+
+    // All blocks together hold (2^MAX_BLOCKS - 1) << firstBlockShift spaces
+    unsigned long long spaces = ((1ULL << MAX_BLOCKS) - 1) << firstBlockShift;
+    capacity = static_cast<int>(min<unsigned long long>(spaces, INT_MAX));
+}
+
+// Destructor
+ConcurrentStash::~ConcurrentStash()
+{
+    for (int b = 0; b < MAX_BLOCKS; ++b)
+    {
+        delete blocks[b].load(memory_order_relaxed);
+    }
+}
+
+// Map an index to its block and offset: index + 2^shift has its highest bit at block + shift
+void ConcurrentStash::locate(int index, int& block, int& offset) const
+{
+    unsigned int position = static_cast<unsigned int>(index) + (1u << firstBlockShift);
+    int highestBit = 31 - __builtin_clz(position);
+    block = highestBit - firstBlockShift;
+    offset = static_cast<int>(position - (1u << highestBit));
+}
+
+// Install a block if no thread has yet; losers of the race free their copy
+ConcurrentStash::Block* ConcurrentStash::ensureBlock(int block)
+{
+    Block* current = blocks[block].load(memory_order_acquire);
+    if (current != nullptr)
+    {
+        return current;
+    }
+
+    size_t spaces = size_t(1) << (firstBlockShift + block);
+    Block* fresh = new Block(spaces * size, spaces);
+    if (blocks[block].compare_exchange_strong(current, fresh, memory_order_acq_rel, memory_order_acquire))
+    {
+        return fresh;
+    }
+    delete fresh;
+    return current; // Installed by another thread
+}
+
+// Add an element
+int ConcurrentStash::add(const void* element)
+{
+    // Reserve a space, leaving next untouched once the directory is full
+    int index = next.load(memory_order_relaxed);
+    do
+    {
+        if (index >= capacity)
+        {
+            throw length_error("ConcurrentStash::add(): Capacity exhausted");
+        }
+    } while (!next.compare_exchange_weak(index, index + 1, memory_order_relaxed));
+
+    int block, offset;
+    locate(index, block, offset);
+
+    Block* target = ensureBlock(block);
+    memcpy(target->data + offset * size, element, size);
+    target->published[offset].store(1, memory_order_release);
+
+    // Halfway through a block, install the next one before anyone needs it
+    unsigned long long nextStart = ((1ULL << (block + 1)) - 1) << firstBlockShift;
+    if (static_cast<size_t>(offset) == (size_t(1) << (firstBlockShift + block)) / 2 && block + 1 < MAX_BLOCKS &&
+        nextStart < static_cast<unsigned long long>(capacity))
+    {
+        try
+        {
+            ensureBlock(block + 1);
+        }
+        catch (const bad_alloc&)
+        {
+            // The element is stored; the add() that reaches the block retries and reports it
+        }
+    }
+    return index; // Return index of added element
+}
+
+// Fetch an element; a reserved space still being written yields nullptr
+void* ConcurrentStash::fetch(int index)
+{
+    if (index < 0 || index >= count()) // Check range
+    {
+        throw out_of_range("ConcurrentStash::fetch(): Index out of range");
+    }
+
+    int block, offset;
+    locate(index, block, offset);
+    Block* target = blocks[block].load(memory_order_acquire);
+    if (target == nullptr || target->published[offset].load(memory_order_acquire) == 0)
+    {
+        return nullptr;
+    }
+    return target->data + offset * size;
+}
+
+// Let threads append disjoint value ranges at once, then check every value landed exactly once
+bool stressConcurrentStash(int threads, int perThread)
+{
+    ConcurrentStash stash(sizeof(int), 16);
+    vector<thread> workers;
+    for (int t = 0; t < threads; ++t)
+    {
+        workers.emplace_back([&stash, t, perThread]()
+        {
+            for (int i = 0; i < perThread; ++i)
+            {
+                int value = t * perThread + i;
+                stash.add(&value);
+            }
+        });
+    }
+    for (thread& worker : workers)
+    {
+        worker.join();
+    }
+
+    if (stash.count() != threads * perThread)
+    {
+        return false;
+    }
+    vector<bool> seen(threads * perThread, false);
+    for (int i = 0; i < stash.count(); ++i)
+    {
+        int* value = static_cast<int*>(stash.fetch(i));
+        if (value == nullptr || *value < 0 || *value >= threads * perThread || seen[*value])
+        {
+            return false;
+        }
+        seen[*value] = true;
+    }
+    return true;
+}
+
+#ifdef __linux__
+// Stash whose storage is a memory-mapped file. A small header at the start
+// of the file records size, quantity and next, so reopening the file
+// restores the Stash without copying a single element. Growing and
+// shrinking resize the file with ftruncate and the mapping with mremap.
+class MappedStash
+{
+private:
+    static const uint32_t MAGIC = 0x4853544D; // "MTSH"
+    static const uint32_t VERSION = 1;
+    static const size_t HEADER_BYTES = 64; // Keeps the elements cache-line aligned
+
+    struct Header
+    {
+        uint32_t magic;    // Identifies a MappedStash file
+        uint32_t version;  // File layout version
+        int32_t size;      // Size of each space
+        int32_t quantity;  // Number of storage spaces
+        int32_t next;      // Next empty space
+    };
+
+    int fd;                 // Backing file
+    unsigned char* mapping; // Header followed by the elements
+    size_t mappedBytes;     // Length of the mapping
+
+    Header* header() const { return reinterpret_cast<Header*>(mapping); }
+    unsigned char* storage() const { return mapping + HEADER_BYTES; }
+    void resize(int newQuantity); // Resize the file and the mapping together
+
+public:
+    MappedStash(const string& path, int sz, int initialCapacity = 16); // Create or reopen
+    ~MappedStash(); // Destructor
+    MappedStash(const MappedStash&) = delete;
+    MappedStash& operator=(const MappedStash&) = delete;
+    MappedStash(MappedStash&& other) noexcept; // Move constructor
+    MappedStash& operator=(MappedStash&& other) noexcept; // Move assignment operator
+
+    // Member functions
+    int add(const void* element); // Add an element
+    void* fetch(int index); // Fetch an element
+    int count() const { return header()->next; } // Count the number of elements
+    int capacity() const { return header()->quantity; } // Number of storage spaces
+    void inflate(int increase); // Increase the size of the file
+    void remove(int index); // Remove an element at specified position
+    void contract(double threshold = 0.3); // Shrink the file when necessary
+    void sync(); // Flush the mapping to disk
+}; // MappedStash
+
+// Create the file, or reopen it and restore size, quantity and next from its header
+MappedStash::MappedStash(const string& path, int sz, int initialCapacity) :
+    fd(-1), mapping(nullptr), mappedBytes(0)
+{
+    if (sz <= 0 || initialCapacity <= 0)
+    {
+        throw invalid_argument("MappedStash: Element size and capacity must be positive");
+    }
+
+    fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0)
+    {
+        throw system_error(errno, generic_category(), "MappedStash: Cannot open " + path);
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0)
+    {
+        int error = errno;
+        close(fd);
+        throw system_error(error, generic_category(), "MappedStash: Cannot stat " + path);
+    }
+
+    bool fresh = (info.st_size == 0);
+    mappedBytes = fresh ? HEADER_BYTES + static_cast<size_t>(sz) * initialCapacity : info.st_size;
+    if ((fresh && ftruncate(fd, mappedBytes) != 0) ||
+        (!fresh && mappedBytes < HEADER_BYTES))
+    {
+        close(fd);
+        throw runtime_error("MappedStash: Cannot size " + path);
+    }
+
+    void* address = mmap(nullptr, mappedBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (address == MAP_FAILED)
+    {
+        int error = errno;
+        close(fd);
+        throw system_error(error, generic_category(), "MappedStash: Cannot map " + path);
+    }
+    mapping = static_cast<unsigned char*>(address);
+
+    if (fresh)
+    {
+        *header() = Header{MAGIC, VERSION, sz, initialCapacity, 0};
+        return;
+    }
+
+    const Header& existing = *header();
+    if (existing.magic != MAGIC || existing.version != VERSION || existing.size != sz ||
+        existing.next < 0 || existing.next > existing.quantity ||
+        HEADER_BYTES + static_cast<size_t>(existing.size) * existing.quantity > mappedBytes)
+    {
+        munmap(mapping, mappedBytes);
+        close(fd);
+        throw invalid_argument("MappedStash: " + path + " is not a Stash of this element size");
+    }
+}
+
+// Destructor; the kernel writes dirty pages back to the file
+MappedStash::~MappedStash()
+{
+    if (mapping != nullptr)
+    {
+        munmap(mapping, mappedBytes);
+    }
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+}
+
+// Move constructor
+MappedStash::MappedStash(MappedStash&& other) noexcept :
+    fd(other.fd), mapping(other.mapping), mappedBytes(other.mappedBytes)
+{
+    other.fd = -1;
+    other.mapping = nullptr;
+    other.mappedBytes = 0;
+}
+
+// Move assignment operator
+MappedStash& MappedStash::operator=(MappedStash&& other) noexcept
+{
+    if (this != &other)
+    {
+        if (mapping != nullptr)
+        {
+            munmap(mapping, mappedBytes);
+        }
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+
+        fd = other.fd;
+        mapping = other.mapping;
+        mappedBytes = other.mappedBytes;
+
+        other.fd = -1;
+        other.mapping = nullptr;
+        other.mappedBytes = 0;
+    }
+    return *this;
+}
+
+// Resize the file and the mapping together; new spaces read as zero
+void MappedStash::resize(int newQuantity)
+{
+    size_t oldBytes = mappedBytes;
+    size_t newBytes = HEADER_BYTES + static_cast<size_t>(header()->size) * newQuantity;
+    if (newBytes > oldBytes && ftruncate(fd, newBytes) != 0)
+    {
+        throw system_error(errno, generic_category(), "MappedStash: Cannot grow file");
+    }
+
+    void* address = mremap(mapping, mappedBytes, newBytes, MREMAP_MAYMOVE);
+    if (address == MAP_FAILED)
+    {
+        throw system_error(errno, generic_category(), "MappedStash: Cannot remap file");
+    }
+    mapping = static_cast<unsigned char*>(address);
+    mappedBytes = newBytes;
+
+    // Shrinking the file is only an optimization, the header decides what is valid
+    if (newBytes < oldBytes && ftruncate(fd, newBytes) != 0)
+    {
+        std::cerr << "MappedStash: Cannot shrink file" << std::endl;
+    }
+    header()->quantity = newQuantity;
+}
+
+// Add an element
+int MappedStash::add(const void* element)
+{
+    Header* h = header();
+    if (h->next >= h->quantity) // Need more space?
+    {
+        inflate(h->quantity);
+        h = header(); // The mapping may have moved
+    }
+
+    memcpy(storage() + static_cast<size_t>(h->next) * h->size, element, h->size);
+
+    ++h->next;
+    return (h->next - 1); // Return index of added element
+}
+
+// Fetch an element
+void* MappedStash::fetch(int index)
+{
+    if (index < 0 || index >= count()) // Check range
+    {
+        throw out_of_range("MappedStash::fetch(): Index out of range");
+    }
+    return storage() + static_cast<size_t>(index) * header()->size;
+}
+
+// Increase the size of the file
+void MappedStash::inflate(int increase)
+{
+    if (increase <= 0)
+    {
+        return; // No increase needed
+    }
+    resize(header()->quantity + increase);
+}
+
+// Remove an element at specified position
+void MappedStash::remove(int index)
+{
+    if (index < 0 || index >= count()) // Check range
+    {
+        throw out_of_range("MappedStash::remove(): Index out of range");
+    }
+
+    Header* h = header();
+    size_t bytesToMove = static_cast<size_t>(h->next - index - 1) * h->size;
+    if (bytesToMove > 0)
+    {
+        unsigned char* hole = storage() + static_cast<size_t>(index) * h->size;
+        memmove(hole, hole + h->size, bytesToMove);
+    }
+    --h->next;
+
+    // Consider contracting if storage utilization is low
+    if (h->next < h->quantity * 0.3 && h->quantity > 16)
+    {
+        contract();
+    }
+}
+
+// Shrink the file when necessary
+void MappedStash::contract(double threshold)
+{
+    if (threshold < 0.0 || threshold > 1.0)
+    {
+        throw invalid_argument("MappedStash::contract(): Threshold must be between 0 and 1");
+    }
+
+    Header* h = header();
+    if (h->quantity <= 16 || h->next >= h->quantity * threshold)
+    {
+        return;
+    }
+
+    int newQuantity = max(16, h->next * 2);
+    if (newQuantity < h->quantity)
+    {
+        resize(newQuantity);
+    }
+}
+
+// Flush the mapping to disk
+void MappedStash::sync()
+{
+    if (msync(mapping, mappedBytes, MS_SYNC) != 0)
+    {
+        throw system_error(errno, generic_category(), "MappedStash::sync(): msync failed");
+    }
+}
+#endif // __linux__
+
+// Fixed set of worker threads that run numbered chunks of a job
+class ThreadPool
+{
+private:
+    vector<thread> workers;          // Worker threads
+    queue<function<void()>> tasks;   // Pending chunks
+    mutex lock;                      // Guards tasks and stopping
+    condition_variable wakeUp;       // Signals new tasks or shutdown
+    bool stopping;                   // Set when the pool is destroyed
+
+    void work(); // Worker loop
+
+public:
+    explicit ThreadPool(int threads = 0); // Constructor, 0 means one thread per core
+    ~ThreadPool(); // Destructor
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    int size() const { return static_cast<int>(workers.size()); } // Number of workers
+    void run(int chunks, const function<void(int)>& chunk); // Run chunk(0..chunks-1) and wait for all
+}; // ThreadPool
+
+// Constructor
+ThreadPool::ThreadPool(int threads) : stopping(false)
+{
+    if (threads <= 0)
+    {
+        threads = max(1, static_cast<int>(thread::hardware_concurrency()));
+    }
+    for (int t = 0; t < threads; ++t)
+    {
+        workers.emplace_back(&ThreadPool::work, this);
+    }
+}
+
+// Destructor
+ThreadPool::~ThreadPool()
+{
+    {
+        lock_guard<mutex> guard(lock);
+        stopping = true;
+    }
+    wakeUp.notify_all();
+    for (thread& worker : workers)
+    {
+        worker.join();
+    }
+}
+
+// Worker loop
+void ThreadPool::work()
+{
+    while (true)
+    {
+        function<void()> task;
+        {
+            unique_lock<mutex> guard(lock);
+            wakeUp.wait(guard, [this]() { return stopping || !tasks.empty(); });
+            if (tasks.empty())
+            {
+                return; // Stopping and nothing left to do
+            }
+            task = std::move(tasks.front());
+            tasks.pop();
+        }
+        task();
+    }
+}
+
+// Run chunk(0..chunks-1) on the workers and wait; the first exception is rethrown here
+void ThreadPool::run(int chunks, const function<void(int)>& chunk)
+{
+    mutex doneLock;
+    condition_variable allDone;
+    int remaining = chunks;
+    exception_ptr failure;
+
+    {
+        lock_guard<mutex> guard(lock);
+        for (int c = 0; c < chunks; ++c)
+        {
+            tasks.push([&, c]()
+            {
+                exception_ptr error;
+                try
+                {
+                    chunk(c);
+                }
+                catch (...)
+                {
+                    error = current_exception();
+                }
+
+                lock_guard<mutex> doneGuard(doneLock);
+                if (error && !failure)
+                {
+                    failure = error;
+                }
+                if (--remaining == 0)
+                {
+                    allDone.notify_one();
+                }
+            });
+        }
+    }
+    wakeUp.notify_all();
+
+    unique_lock<mutex> doneGuard(doneLock);
+    allDone.wait(doneGuard, [&remaining]() { return remaining == 0; });
+    if (failure)
+    {
+        rethrow_exception(failure);
+    }
+}
+
+// Split count elements into chunks of at least minChunk, a few per worker
+inline int chunkCount(const ThreadPool& pool, int count, int minChunk = 4096)
+{
+    return max(1, min(pool.size() * 4, (count + minChunk - 1) / minChunk));
+}
+
+// Call f on every element of the span, spread across the pool
+template <typename T, typename Function>
+void parallelForEach(ThreadPool& pool, StashSpan<T> span, Function f)
+{
+    int chunks = chunkCount(pool, span.size());
+    pool.run(chunks, [&](int c)
+    {
+        long long begin = static_cast<long long>(span.size()) * c / chunks;
+        long long end = static_cast<long long>(span.size()) * (c + 1) / chunks;
+        for (long long i = begin; i < end; ++i)
+        {
+            f(span[i]);
+        }
+    });
+}
+
+// Store f(in[i]) into out[i] for every element; in and out may be the same span
+template <typename T, typename U, typename Function>
+void parallelTransform(ThreadPool& pool, StashSpan<T> in, StashSpan<U> out, Function f)
+{
+    if (in.size() != out.size())
+    {
+        throw invalid_argument("parallelTransform(): Input and output sizes differ");
+    }
+
+    int chunks = chunkCount(pool, in.size());
+    pool.run(chunks, [&](int c)
+    {
+        long long begin = static_cast<long long>(in.size()) * c / chunks;
+        long long end = static_cast<long long>(in.size()) * (c + 1) / chunks;
+        for (long long i = begin; i < end; ++i)
+        {
+            out[i] = f(in[i]);
+        }
+    });
+}
+
+// Fold every chunk of the span from identity with fold(R, T), then merge
+// the partial results in order with combine(R, R)
+template <typename T, typename R, typename Fold, typename Combine>
+R parallelReduce(ThreadPool& pool, StashSpan<T> span, R identity, Fold fold, Combine combine)
+{
+    int chunks = chunkCount(pool, span.size());
+    vector<R> partials(chunks, identity);
+    pool.run(chunks, [&](int c)
+    {
+        long long begin = static_cast<long long>(span.size()) * c / chunks;
+        long long end = static_cast<long long>(span.size()) * (c + 1) / chunks;
+        R partial = identity;
+        for (long long i = begin; i < end; ++i)
+        {
+            partial = fold(partial, span[i]);
+        }
+        partials[c] = partial;
+    });
+
+    R result = identity;
+    for (const R& partial : partials)
+    {
+        result = combine(result, partial);
+    }
+    return result;
+}
+
+// Reduce with one associative op whose identity is given, such as + with 0
+template <typename T, typename R, typename Op>
+R parallelReduce(ThreadPool& pool, StashSpan<T> span, R identity, Op op)
+{
+    return parallelReduce(pool, span, identity, op, op);
+}
+
+// 16-byte record used to benchmark wider fixed-width copies
+struct Record16
+{
+    int a, b, c, d;
+};
+
+// Time adding and fetching n elements through the runtime-sized Stash
+template <typename T>
+double benchmarkStash(int n, long long& checksum)
+{
+    auto start = chrono::steady_clock::now();
+    Stash stash(sizeof(T));
+    T element{};
+    for (int i = 0; i < n; ++i)
+    {
+        memcpy(&element, &i, sizeof(int));
+        stash.add(&element);
+    }
+    for (int i = 0; i < stash.count(); ++i)
+    {
+        checksum += *static_cast<int*>(stash.fetch(i));
+    }
+    auto end = chrono::steady_clock::now();
+    return chrono::duration<double, milli>(end - start).count();
+}
+
+// Time adding and fetching n elements through the compile-time-sized TypedStash
+template <typename T>
+double benchmarkTypedStash(int n, long long& checksum)
+{
+    auto start = chrono::steady_clock::now();
+    TypedStash<T> stash;
+    T element{};
+    for (int i = 0; i < n; ++i)
+    {
+        memcpy(&element, &i, sizeof(int));
+        stash.add(element);
+    }
+    for (int i = 0; i < stash.count(); ++i)
+    {
+        checksum += *reinterpret_cast<int*>(stash.fetch(i));
+    }
+    auto end = chrono::steady_clock::now();
+    return chrono::duration<double, milli>(end - start).count();
+}
+
+// Reallocations per million operations of a workload that swings the
+// element count between low and high, removing from the end
+double reallocationsPerMillion(const StashPolicy& policy, int low, int high, int operations)
+{
+    Stash stash(sizeof(int), 16, policy);
+    for (int i = 0; i < high; ++i)
+    {
+        stash.add(&i);
+    }
+    stash.resetStatistics();
+
+    bool growing = false;
+    for (int op = 0; op < operations; ++op)
+    {
+        if (growing)
+        {
+            stash.add(&op);
+            growing = stash.count() < high;
+        }
+        else
+        {
+            stash.remove(stash.count() - 1);
+            growing = stash.count() <= low;
+        }
+    }
+
+    StashStats stats = stash.statistics();
+    return (stats.inflations + stats.contractions) * 1e6 / operations;
+}
+
+// Compare the runtime-sized Stash against TypedStash for 4- and 16-byte elements
+void runBenchmarks()
+{
+    const int n = 4000000;
+    long long checksum = 0;
+
+    double stashInt = benchmarkStash<int>(n, checksum);
+    double typedInt = benchmarkTypedStash<int>(n, checksum);
+    double stashRecord = benchmarkStash<Record16>(n, checksum);
+    double typedRecord = benchmarkTypedStash<Record16>(n, checksum);
+
+    cout << "add + fetch of " << n << " elements (ms):" << endl;
+    cout << "  4-byte  Stash: " << stashInt << ", TypedStash: " << typedInt
+         << " (x" << stashInt / typedInt << ")" << endl;
+    cout << "  16-byte Stash: " << stashRecord << ", TypedStash: " << typedRecord
+         << " (x" << stashRecord / typedRecord << ")" << endl;
+    cout << "Checksum: " << checksum << endl;
+
+    // Reallocations of workloads that hover around the shrink boundary
+    StashPolicy eager;
+    eager.shrinkThreshold = 0.45;
+    eager.shrinkDelay = 0.0;
+    StashPolicy noDelay;
+    noDelay.shrinkDelay = 0.0;
+    StashPolicy hysteresis;
+    const int operations = 1000000;
+    cout << "Reallocations per million operations (eager / no delay / default policy):" << endl;
+    const int swings[][2] = {{200, 260}, {90, 140}, {20, 70}};
+    for (const auto& swing : swings)
+    {
+        cout << "  count swinging " << swing[0] << ".." << swing[1] << ": "
+             << reallocationsPerMillion(eager, swing[0], swing[1], operations) << " / "
+             << reallocationsPerMillion(noDelay, swing[0], swing[1], operations) << " / "
+             << reallocationsPerMillion(hysteresis, swing[0], swing[1], operations) << endl;
+    }
+
+    // Linear scan through fetch() against binary search over a sorted Stash and an index
+    {
+        const int lookups = 500;
+        auto intLess = [](const void* a, const void* b) { return *static_cast<const int*>(a) < *static_cast<const int*>(b); };
+        Stash sorted(sizeof(int), n / 4);
+        for (int i = 0; i < n / 4; ++i)
+        {
+            int value = static_cast<int>(i * 7919LL % (n / 4));
+            sorted.add(&value);
+        }
+        auto index = makeStashIndex(sorted, intLess);
+        long long found = 0;
+
+        auto start = chrono::steady_clock::now();
+        for (int k = 0; k < lookups; ++k)
+        {
+            int key = static_cast<int>(k * 104729LL % (n / 4));
+            for (int i = 0; i < sorted.count(); ++i)
+            {
+                if (*static_cast<int*>(sorted.fetch(i)) == key)
+                {
+                    found += i;
+                    break;
+                }
+            }
+        }
+        double scanMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+        start = chrono::steady_clock::now();
+        for (int k = 0; k < lookups; ++k)
+        {
+            int key = static_cast<int>(k * 104729LL % (n / 4));
+            found -= index.find(&key);
+        }
+        double indexMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+        sorted.sort(intLess);
+        start = chrono::steady_clock::now();
+        for (int k = 0; k < lookups; ++k)
+        {
+            int key = static_cast<int>(k * 104729LL % (n / 4));
+            found += sorted.find(&key, intLess);
+        }
+        double searchMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        cout << lookups << " lookups in " << n / 4 << " elements: linear scan " << scanMs << " ms, index "
+             << indexMs << " ms, sorted find " << searchMs << " ms (checksum " << found << ")" << endl;
+    }
+
+    // Scanning one field of 64-byte records: array of structures against one column
+    {
+        struct Wide
+        {
+            double value;
+            char payload[56];
+        };
+        const int records = n / 4;
+        Stash rows(sizeof(Wide), records);
+        ColumnStash columns({{offsetof(Wide, value), sizeof(double)}, {offsetof(Wide, payload), 56}},
+                            sizeof(Wide), records);
+        Wide row = {};
+        for (int i = 0; i < records; ++i)
+        {
+            row.value = i;
+            rows.add(&row);
+            columns.add(&row);
+        }
+
+        auto start = chrono::steady_clock::now();
+        double rowSum = 0.0;
+        for (const Wide& r : rows.view<Wide>())
+        {
+            rowSum += r.value;
+        }
+        double rowMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+        start = chrono::steady_clock::now();
+        double columnSum = 0.0;
+        for (double value : columns.column<double>(0))
+        {
+            columnSum += value;
+        }
+        double columnMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        cout << "Field scan over " << records << " 64-byte records: rows " << rowMs << " ms, column "
+             << columnMs << " ms" << (rowSum == columnSum ? "" : " MISMATCH") << endl;
+    }
+
+    // Serial loop over fetch() against a parallel reduce over a typed view
+    {
+        Stash big(sizeof(int), n);
+        for (int i = 0; i < n; ++i)
+        {
+            big.add(&i);
+        }
+        auto start = chrono::steady_clock::now();
+        long long serial = 0;
+        for (int i = 0; i < big.count(); ++i)
+        {
+            serial += *static_cast<int*>(big.fetch(i)) % 7;
+        }
+        double serialMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+        ThreadPool pool;
+        start = chrono::steady_clock::now();
+        long long parallel = parallelReduce(pool, big.view<int>(), 0LL,
+            [](long long sum, int element) { return sum + element % 7; },
+            [](long long a, long long b) { return a + b; });
+        double parallelMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        cout << "Reduce over " << n << " elements: fetch() loop " << serialMs << " ms, parallelReduce on "
+             << pool.size() << " thread(s) " << parallelMs << " ms" << (serial == parallel ? "" : " MISMATCH") << endl;
+    }
+
+    // Concurrent append throughput from one thread up to the core count
+    const int totalAdds = 8000000;
+    int maxThreads = max(4, static_cast<int>(thread::hardware_concurrency()));
+    cout << "ConcurrentStash add of " << totalAdds << " elements:" << endl;
+    for (int threads = 1; threads <= maxThreads; threads *= 2)
+    {
+        ConcurrentStash stash(sizeof(int));
+        auto start = chrono::steady_clock::now();
+        vector<thread> workers;
+        for (int t = 0; t < threads; ++t)
+        {
+            workers.emplace_back([&stash, threads, totalAdds]()
+            {
+                for (int i = 0; i < totalAdds / threads; ++i)
+                {
+                    stash.add(&i);
+                }
+            });
+        }
+        for (thread& worker : workers)
+        {
+            worker.join();
+        }
+        double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        cout << "  " << threads << " thread(s): " << ms << " ms, "
+             << stash.count() / ms / 1000.0 << " M adds/s" << endl;
+    }
+}
+
+// Byte-packed containers driven by the benchmark suite, each holding
+// fixed-size elements behind the same small interface as Stash
+class StashSubject
+{
+private:
+    Stash stash;
+
+public:
+    static const char* name() { return "Stash"; }
+    explicit StashSubject(int sz) : stash(sz) {}
+    void add(const void* element) { stash.add(element); }
+    int count() const { return stash.count(); }
+    int first(int index) const { int v; memcpy(&v, stash.fetch(index), sizeof(int)); return v; }
+    long long scan() const
+    {
+        long long sum = 0;
+        for (int i = 0; i < stash.count(); ++i)
+        {
+            int v;
+            memcpy(&v, stash.fetch(i), sizeof(int));
+            sum += v;
+        }
+        return sum;
+    }
+    void remove(int index) { stash.remove(index); }
+    void removeLast() { stash.remove(stash.count() - 1); }
+}; // StashSubject
+
+class VectorSubject
+{
+private:
+    int size;
+    vector<unsigned char> bytes;
+
+public:
+    static const char* name() { return "vector<unsigned char>"; }
+    explicit VectorSubject(int sz) : size(sz) {}
+    void add(const void* element)
+    {
+        const unsigned char* e = static_cast<const unsigned char*>(element);
+        bytes.insert(bytes.end(), e, e + size);
+    }
+    int count() const { return static_cast<int>(bytes.size() / size); }
+    int first(int index) const { int v; memcpy(&v, &bytes[static_cast<size_t>(index) * size], sizeof(int)); return v; }
+    long long scan() const
+    {
+        long long sum = 0;
+        for (size_t offset = 0; offset < bytes.size(); offset += size)
+        {
+            int v;
+            memcpy(&v, &bytes[offset], sizeof(int));
+            sum += v;
+        }
+        return sum;
+    }
+    void remove(int index)
+    {
+        auto at = bytes.begin() + static_cast<size_t>(index) * size;
+        bytes.erase(at, at + size);
+    }
+    void removeLast() { bytes.resize(bytes.size() - size); }
+}; // VectorSubject
+
+class DequeSubject
+{
+private:
+    int size;
+    deque<unsigned char> bytes;
+
+public:
+    static const char* name() { return "deque<unsigned char>"; }
+    explicit DequeSubject(int sz) : size(sz) {}
+    void add(const void* element)
+    {
+        const unsigned char* e = static_cast<const unsigned char*>(element);
+        bytes.insert(bytes.end(), e, e + size);
+    }
+    int count() const { return static_cast<int>(bytes.size() / size); }
+    int first(int index) const
+    {
+        int v;
+        copy_n(bytes.begin() + static_cast<size_t>(index) * size, sizeof(int), reinterpret_cast<unsigned char*>(&v));
+        return v;
+    }
+    long long scan() const
+    {
+        long long sum = 0;
+        auto it = bytes.begin();
+        for (size_t offset = 0; offset < bytes.size(); offset += size, it += size)
+        {
+            int v;
+            copy_n(it, sizeof(int), reinterpret_cast<unsigned char*>(&v));
+            sum += v;
+        }
+        return sum;
+    }
+    void remove(int index)
+    {
+        auto at = bytes.begin() + static_cast<size_t>(index) * size;
+        bytes.erase(at, at + size);
+    }
+    void removeLast() { bytes.erase(bytes.end() - size, bytes.end()); }
+}; // DequeSubject
+
+// Milliseconds taken by one call of f
+template <typename Function>
+double timeMs(Function f)
+{
+    auto start = chrono::steady_clock::now();
+    f();
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+// Time every suite operation on one container, element size and count,
+// writing one CSV line per operation
+template <typename Subject>
+void benchmarkSubject(ostream& out, int sz, int n)
+{
+    vector<unsigned char> element(sz, 0);
+    unsigned seed = 12345;
+    auto nextRandom = [&seed]() { seed = seed * 1103515245u + 12345u; return static_cast<int>(seed >> 8); };
+    auto report = [&out, sz, n](const char* operation, double ms, long long ops, long long checksum)
+    {
+        out << Subject::name() << ',' << sz << ',' << n << ',' << operation << ',' << ms << ','
+            << (ops > 0 ? ms * 1e6 / ops : 0.0) << ',' << checksum << '\n';
+    };
+
+    Subject subject(sz);
+    long long checksum = 0;
+    double ms = timeMs([&]()
+    {
+        for (int i = 0; i < n; ++i)
+        {
+            memcpy(element.data(), &i, sizeof(int));
+            subject.add(element.data());
+        }
+    });
+    report("add", ms, n, subject.count());
+
+    checksum = 0;
+    ms = timeMs([&]()
+    {
+        for (int i = 0; i < n; ++i)
+        {
+            checksum += subject.first(nextRandom() % n);
+        }
+    });
+    report("fetch", ms, n, checksum);
+
+    checksum = 0;
+    ms = timeMs([&]() { checksum = subject.scan(); });
+    report("scan", ms, n, checksum);
+
+    {
+        Subject copy(subject);
+        ms = timeMs([&]() { Subject again(subject); checksum = again.count(); });
+        report("copy", ms, 1, checksum);
+
+        const int moves = 1000;
+        ms = timeMs([&]()
+        {
+            for (int i = 0; i < moves; ++i)
+            {
+                Subject moved(std::move(copy));
+                copy = std::move(moved);
+            }
+        });
+        report("move", ms, 2LL * moves, copy.count());
+    }
+
+    // Order-preserving removal is linear per call, so cap the number of removals
+    const int removals = min(n / 2, 2000);
+    checksum = 0;
+    ms = timeMs([&]()
+    {
+        for (int i = 0; i < removals; ++i)
+        {
+            int index = nextRandom() % subject.count();
+            checksum += subject.first(index);
+            subject.remove(index);
+        }
+    });
+    report("random_remove", ms, removals, checksum);
+
+    // Swing the count between n and n / 8 from the end so storage inflates and contracts
+    const int cycles = 4;
+    long long ops = 0;
+    ms = timeMs([&]()
+    {
+        for (int c = 0; c < cycles; ++c)
+        {
+            while (subject.count() > n / 8)
+            {
+                subject.removeLast();
+                ++ops;
+            }
+            for (int i = subject.count(); i < n; ++i)
+            {
+                memcpy(element.data(), &i, sizeof(int));
+                subject.add(element.data());
+                ++ops;
+            }
+        }
+    });
+    report("churn", ms, ops, subject.count());
+}
+
+// Run the suite for every container, element size and count, writing CSV to out
+void runBenchmarkSuite(ostream& out)
+{
+    const int sizes[] = {4, 16, 64};
+    const int counts[] = {1000, 100000, 1000000};
+
+    out << "container,element_size,count,operation,ms,ns_per_op,checksum\n";
+    for (int sz : sizes)
+    {
+        for (int n : counts)
+        {
+            benchmarkSubject<StashSubject>(out, sz, n);
+            benchmarkSubject<VectorSubject>(out, sz, n);
+            benchmarkSubject<DequeSubject>(out, sz, n);
+        }
+    }
+}
+
+// Test the Stash class
+// Run with --bench to time the Stash variants instead, or with
+// --bench-suite [file.csv] to compare Stash against the standard containers
+int main(int argc, char* argv[])
+{
+    if (argc > 1 && string(argv[1]) == "--bench-suite")
+    {
+        if (argc > 2)
+        {
+            ofstream csv(argv[2]);
+            if (!csv)
+            {
+                cerr << "Cannot open " << argv[2] << endl;
+                return 1;
+            }
+            runBenchmarkSuite(csv);
+        }
+        else
+        {
+            runBenchmarkSuite(cout);
+        }
+        return 0;
+    }
+    if (argc > 1 && string(argv[1]) == "--bench")
+    {
+        runBenchmarks();
+        return 0;
+    }
+
+    // Create a Stash for integers and report every memory operation
+    Stash stash(sizeof(int));
+    stash.setVerbose(true);
+    
+    // Add some integers
+    for (int i = 0; i < 10; ++i)
+    {
+        stash.add(&i);
+    }
+    stash.stashInfo();
+    
+    // Fetch and print elements
+    for (int i = 0; i < stash.count(); ++i)
+    {
+        int* value = static_cast<int*>(stash.fetch(i));
+        cout << "Element at index " << i << ": " << *value << endl;
+    }
+    
+    // Add more elements in one go
+    int more[90];
+    for (int i = 0; i < 90; ++i)
+    {
+        more[i] = i + 10;
+    }
+    stash.addRange(more, 90);
+    stash.stashInfo();
+
+    // Remove a single element, keeping and then ignoring the order
+    stash.remove(0);
+    stash.removeUnordered(0);
+
+    // Remove every multiple of 7 in one pass
+    stash.removeIf([](const void* element) { return *static_cast<const int*>(element) % 7 == 0; });
+    stash.stashInfo();
+
+    // Randomly remove about 80% of elements
+    stash.removeIf([](const void*) { return rand() % 100 < 80; });
+    stash.stashInfo();
+
+    // Remove the first three survivors by position
+    int firstThree[] = {0, 1, 2};
+    stash.removeMany(firstThree, 3);
+    stash.stashInfo();
+
+    // Walk the elements through a typed view and fold them on a thread pool
+    ThreadPool pool;
+    StashSpan<int> elements = stash.view<int>();
+    long long serialSum = 0;
+    for (int element : elements)
+    {
+        serialSum += element;
+    }
+    long long parallelSum = parallelReduce(pool, elements, 0LL, [](long long a, long long b) { return a + b; });
+    parallelTransform(pool, elements, elements, [](int element) { return element * 2; });
+    cout << "Sum of elements: " << serialSum << " serial, " << parallelSum << " parallel, "
+         << parallelReduce(pool, elements, 0LL, [](long long a, long long b) { return a + b; })
+         << " after doubling" << endl;
+
+    // Order lookups through a secondary index, then sort the Stash itself
+    auto intLess = [](const void* a, const void* b) { return *static_cast<const int*>(a) < *static_cast<const int*>(b); };
+    auto byValue = makeStashIndex(stash, intLess);
+    int wanted = stash.view<int>()[stash.count() / 2];
+    cout << "Index finds " << wanted << " at position " << byValue.find(&wanted) << endl;
+    stash.sort([&intLess](const void* a, const void* b) { return intLess(b, a); }); // Descending
+    stash.stashInfo();
+
+    // Copy-on-write copies share storage until one of them is written
+    stash.setCopyOnWrite(true);
+    Stash reader = stash;
+    cout << "Copy shares storage: " << (reader.isShared() ? "yes" : "no") << endl;
+    int extra = 1000;
+    reader.add(&extra);
+    cout << "Copy shares storage after add: " << (reader.isShared() ? "yes" : "no") << endl;
+
+    // Save a snapshot and restore it in one read
+    stash.save("stash.bin");
+    Stash restored = Stash::load("stash.bin");
+    std::remove("stash.bin");
+    cout << "Restored " << restored.count() << " elements from snapshot"
+         << (restored.isInline() ? " into inline storage" : "") << endl;
+
+    // Clean up
+    stash.cleanUp();
+    stash.stashInfo();
+
+    // Attempt to fetch after cleanup
+    try
+    {
+        stash.fetch(0);
     }
     catch (const out_of_range& e)
     {
@@ -398,5 +3636,126 @@ int main()
         cout << "Error: " << e.what() << endl;
     }
 
+    // Typed Stash with the element size known at compile time
+    TypedStash<int> typedStash;
+    for (int i = 0; i < 10; ++i)
+    {
+        typedStash.add(i * i);
+    }
+    typedStash.remove(0);
+    cout << "TypedStash contents: ";
+    for (int i = 0; i < typedStash.count(); ++i)
+    {
+        cout << *typedStash.fetch(i) << " ";
+    }
+    cout << endl;
+
+    // Segmented Stash keeps fetched pointers valid while it grows
+    SegmentedStash segmented(sizeof(int), 8);
+    for (int i = 0; i < 4; ++i)
+    {
+        segmented.add(&i);
+    }
+    int* first = static_cast<int*>(segmented.fetch(0));
+    for (int i = 4; i < 100; ++i)
+    {
+        segmented.add(&i);
+    }
+    segmented.remove(50);
+    cout << "SegmentedStash: " << segmented.count() << " elements in capacity " << segmented.capacity()
+         << ", first element still " << *first
+         << (first == segmented.fetch(0) ? " at the same address" : " at a new address")
+         << ", element 50 is now " << *static_cast<int*>(segmented.fetch(50)) << endl;
+
+    // Compress the blocks nobody has read lately and read them back through the cache
+    SegmentedStash archive(sizeof(int), 1024);
+    for (int i = 0; i < 100000; ++i)
+    {
+        int record = i / 16;
+        archive.add(&record);
+    }
+    long long rawBytes = archive.compressionStatistics().residentBytes;
+    archive.compressCold(0);
+    const SegmentedStash& archiveReader = archive;
+    long long total = 0;
+    for (int i = 0; i < archive.count(); i += 97)
+    {
+        total += *static_cast<const int*>(archiveReader.fetch(i));
+    }
+    CompressionStats compression = archive.compressionStatistics();
+    cout << "Cold compression: " << rawBytes << " -> " << compression.residentBytes << " resident bytes, "
+         << compression.blocksCompressed << " blocks packed, " << compression.cacheHits << " cache hits, "
+         << compression.cacheMisses << " misses, checksum " << total << endl;
+
+    // Writes thaw blocks; the scheduled passes pack them again once they go idle
+    archive.compressEvery(100, 50);
+    for (int i = 0; i < archive.count(); i += 97)
+    {
+        ++*static_cast<int*>(archive.fetch(i));
+    }
+    compression = archive.compressionStatistics();
+    cout << "Scheduled re-freeze: " << compression.blocksThawed << " blocks thawed by writes, "
+         << compression.blocksCompressed << " packed in total, " << compression.residentBytes << " resident bytes" << endl;
+    archive.compressCold(0);
+    archive.remove(0);
+    cout << "After removing the first record: " << archive.compressionStatistics().residentBytes << " resident bytes, first record "
+         << *static_cast<const int*>(archiveReader.fetch(0)) << endl;
+
+    // Aligned storage, and a record split into one column per field
+    StashPolicy aligned;
+    aligned.alignment = 64;
+    Stash alignedStash(sizeof(double), 1024, aligned);
+    double price = 2.5;
+    alignedStash.add(&price);
+    cout << "Aligned Stash storage is " << (reinterpret_cast<uintptr_t>(alignedStash.fetch(0)) % 64 == 0 ? "" : "NOT ")
+         << "64-byte aligned" << endl;
+
+    struct Order
+    {
+        int id;
+        double price;
+        char tag[4];
+    };
+    ColumnStash orders({{offsetof(Order, id), sizeof(int)}, {offsetof(Order, price), sizeof(double)},
+                        {offsetof(Order, tag), 4}}, sizeof(Order));
+    for (int i = 0; i < 100; ++i)
+    {
+        Order order = {i, i * 0.5, {'A', 'B', 'C', 'D'}};
+        orders.add(&order);
+    }
+    orders.remove(0);
+    double totalPrice = 0.0;
+    for (double p : orders.column<double>(1))
+    {
+        totalPrice += p;
+    }
+    Order last;
+    orders.fetch(orders.count() - 1, &last);
+    cout << "ColumnStash: " << orders.count() << " orders, price column sum " << totalPrice
+         << ", last order id " << last.id << endl;
+
+    // Several producer threads appending into one ConcurrentStash
+    cout << "ConcurrentStash stress test: "
+         << (stressConcurrentStash(8, 100000) ? "passed" : "FAILED") << endl;
+
+#ifdef __linux__
+    // File-backed Stash survives closing and reopening without a load step
+    const char* mappedPath = "mapped_stash.bin";
+    {
+        MappedStash mapped(mappedPath, sizeof(int));
+        for (int i = 0; i < 100; ++i)
+        {
+            mapped.add(&i);
+        }
+        mapped.remove(0);
+    }
+    {
+        MappedStash reopened(mappedPath, sizeof(int));
+        cout << "MappedStash reopened with " << reopened.count() << " elements in capacity "
+             << reopened.capacity() << ", element 41 is " << *static_cast<int*>(reopened.fetch(41)) << endl;
+    }
+    unlink(mappedPath);
+#endif
+
     return 0;
 }
\ No newline at end of file
@@ -31,45 +31,301 @@ The output is here:
 */
 
 #include <iostream>
+#include <streambuf>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <queue>
+#include <exception>
+#include <list>
+#include <unordered_map>
+#include <stdexcept>
+#include <type_traits>
+#include <system_error>
+#include <cerrno>
+#ifdef __linux__
+#include <unistd.h>
+#endif
 using namespace std;
 
+// Run of identical characters on one line of a shape: cells start, start + step, ...
+// up to end (exclusive) hold ch, and any cells skipped by step are spaces
+struct Span
+{
+    int start;  // First column
+    int end;    // One past the last column
+    char ch;    // Character drawn
+    int step;   // Distance between drawn cells
+};
+
+// Most runs any shape reports for one line
+const int MAX_SPANS = 4;
+
+// Fixed set of worker threads running queued tasks
+class ThreadPool
+{
+private:
+    vector<thread> workers;          // Worker threads
+    queue<function<void()>> tasks;   // Pending tasks
+    mutex lock;                      // Guards tasks and stopping
+    condition_variable wakeUp;       // Signals new tasks or shutdown
+    bool stopping;                   // Set when the pool is destroyed
+
+    void work()
+    {
+        while (true)
+        {
+            function<void()> task;
+            {
+                unique_lock<mutex> guard(lock);
+                wakeUp.wait(guard, [this]() { return stopping || !tasks.empty(); });
+                if (tasks.empty())
+                {
+                    return; // Stopping and nothing left to do
+                }
+                task = std::move(tasks.front());
+                tasks.pop();
+            }
+            task();
+        }
+    }
+
+public:
+    // 0 threads means one per core
+    explicit ThreadPool(int threads = 0) : stopping(false)
+    {
+        if (threads <= 0)
+        {
+            threads = max(1, static_cast<int>(thread::hardware_concurrency()));
+        }
+        for (int t = 0; t < threads; t++)
+        {
+            workers.emplace_back(&ThreadPool::work, this);
+        }
+    }
+
+    ~ThreadPool()
+    {
+        {
+            lock_guard<mutex> guard(lock);
+            stopping = true;
+        }
+        wakeUp.notify_all();
+        for (thread& worker : workers)
+        {
+            worker.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    int size() const
+    {
+        return static_cast<int>(workers.size());
+    }
+
+    // Queue a task; it must not throw
+    void submit(function<void()> task)
+    {
+        {
+            lock_guard<mutex> guard(lock);
+            tasks.push(std::move(task));
+        }
+        wakeUp.notify_one();
+    }
+};
+
+class RowSink;
+
 // Interface for shape drawing
 class ShapeDrawer 
 {
 public:
-    virtual void operator()(int row) const = 0;  // Function object pattern
+    // Function object pattern: draw to cout, in parallel bands for large shapes
+    virtual void operator()(int row) const;
     virtual ~ShapeDrawer() {}
+
+    // Widest line the shape produces, without the newline
+    virtual int width(int row) const = 0;
+
+    // Report the runs of line i from left to right, returning how many there are
+    virtual int spans(int row, int i, Span* runs) const = 0;
+
+    // Write line i of the shape into line, returning its length without the newline
+    int rasterizeRow(int row, int i, char* line) const;
+
+    // Draw the shape one cell at a time, kept to compare against render()
+    virtual void drawPerCell(int row, ostream& out) const;
+
+    // Rasterize rows into a large buffer and hand it to out in a few big writes
+    void render(int row, ostream& out) const;
+
+    // Rasterize bands of rows on the pool and write them to out in order
+    void renderParallel(int row, ostream& out, ThreadPool& pool) const;
+
+    // Generate the shape piece by piece through one fixed buffer into sink,
+    // in constant memory however large row is; sink is closed at the end
+    void stream(int row, RowSink& sink) const;
 };
 
+// Fill one run; stepped runs write a single period and double it with memcpy
+static void fillSpan(char* line, const Span& run)
+{
+    int length = run.end - run.start;
+    char* cells = line + run.start;
+    if (run.step <= 1)
+    {
+        memset(cells, run.ch, length);
+        return;
+    }
+
+    int period = min(run.step, length);
+    cells[0] = run.ch;
+    memset(cells + 1, ' ', period - 1);
+    for (int done = period; done < length; done *= 2)
+    {
+        memcpy(cells + done, cells, min(done, length - done));
+    }
+}
+
+// Write the runs of one line, returning its length without the newline
+static int fillSpans(const Span* runs, int count, char* line)
+{
+    int length = 0;
+    for (int k = 0; k < count; k++)
+    {
+        memset(line + length, ' ', runs[k].start - length); // Gap before the run
+        fillSpan(line, runs[k]);
+        length = runs[k].end;
+    }
+    return length;
+}
+
+int ShapeDrawer::rasterizeRow(int row, int i, char* line) const
+{
+    Span runs[MAX_SPANS];
+    return fillSpans(runs, spans(row, i, runs), line);
+}
+
+void ShapeDrawer::drawPerCell(int row, ostream& out) const
+{
+    vector<char> line(max(width(row), 1));
+    for (int i = 0; i < row; i++)
+    {
+        int length = rasterizeRow(row, i, line.data());
+        for (int j = 0; j < length; j++)
+        {
+            out << line[j];
+        }
+        out << endl;
+    }
+}
+
+// Bytes collected before the renderer writes to the stream
+const size_t RENDER_BUFFER_BYTES = 64 * 1024;
+
+// Collect the lines produced by rasterize(i, line) in a large buffer and hand
+// it to out in a few big writes; lineBytes must leave room for the newline
+template <typename RowWriter>
+static void writeRows(int row, size_t lineBytes, ostream& out, RowWriter rasterize)
+{
+    vector<char> buffer(max(RENDER_BUFFER_BYTES, lineBytes));
+    size_t used = 0;
+    for (int i = 0; i < row; i++) 
+    {
+        if (buffer.size() - used < lineBytes) 
+        {
+            out.write(buffer.data(), used);
+            used = 0;
+        }
+        used += rasterize(i, buffer.data() + used);
+        buffer[used++] = '\n';
+    }
+    out.write(buffer.data(), used);
+    out.flush();
+}
+
+void ShapeDrawer::render(int row, ostream& out) const
+{
+    if (row <= 0) 
+    {
+        return;
+    }
+
+    size_t lineBytes = static_cast<size_t>(width(row)) + 1; // Room for the newline
+    writeRows(row, lineBytes, out, [this, row](int i, char* line) { return rasterizeRow(row, i, line); });
+}
+
 // Triangle drawer implementation
-class TriangleDrawer : public ShapeDrawer 
+class TriangleDrawer final : public ShapeDrawer 
 {
 public:
-    void operator()(int row) const override 
+    int width(int row) const override 
+    {
+        return 2 * row - 1;
+    }
+
+    int spans(int row, int i, Span* runs) const override 
+    {
+        // Stars centred under the apex, widening by one on each side per row
+        runs[0] = {row - i - 1, row + i, '*', 1};
+        return 1;
+    }
+
+    void drawPerCell(int row, ostream& out) const override 
     {
         for (int i = 0; i < row; i++) 
         {
             // Print spaces before stars
             for (int j = 0; j < row - i - 1; j++) 
             {
-                cout << " ";
+                out << " ";
             }
             
             // Print stars in triangular pattern
             for (int j = 0; j < 2 * i + 1; j++) 
             {
-                cout << "*";
+                out << "*";
             }
-            cout << endl;
+            out << endl;
         }
     }
 };
 
 // Square drawer implementation
-class SquareDrawer : public ShapeDrawer 
+class SquareDrawer final : public ShapeDrawer 
 {
 public:
-    void operator()(int row) const override 
+    int width(int row) const override 
+    {
+        return 2 * row - 1;
+    }
+
+    int spans(int row, int i, Span* runs) const override 
+    {
+        int length = 2 * row - 1;
+        if (i == 0 || i == row - 1) 
+        {
+            // First and last rows: pluses in the even columns
+            runs[0] = {0, length, '+', 2};
+            return 1;
+        }
+
+        // Middle rows: a plus at each edge
+        runs[0] = {0, 1, '+', 1};
+        runs[1] = {length - 1, length, '+', 1};
+        return 2;
+    }
+
+    void drawPerCell(int row, ostream& out) const override 
     {
         for (int i = 0; i < row; i++) 
         {
@@ -78,28 +334,100 @@ public:
                 // First and last rows
                 for (int j = 0; j < row; j++) 
                 {
-                    cout << "+";
-                    if (j < row - 1) cout << " ";
+                    out << "+";
+                    if (j < row - 1) out << " ";
                 }
             } 
             else 
             {
                 // Middle rows
-                cout << "+";
+                out << "+";
                 for (int j = 0; j < 2 * (row - 2) + 1; j++) 
                 {
-                    cout << " ";
+                    out << " ";
                 }
-                cout << "+";
+                out << "+";
             }
-            cout << endl;
+            out << endl;
         }
     }
 };
 
-// Additional shapes can be easily added
-// class CircleDrawer : public ShapeDrawer { ... }
-// class StarDrawer : public ShapeDrawer { ... }
+// Half the number of columns a disc of row lines covers on line i; columns are
+// counted at half a line each so round shapes are not squashed sideways
+static int discHalfWidth(int row, int i, double radius)
+{
+    double y = i + 0.5 - row / 2.0;
+    double halfWidth = 2.0 * sqrt(max(0.0, radius * radius - y * y));
+    return min(static_cast<int>(lround(halfWidth)), row - 1);
+}
+
+// Circle drawer implementation
+class CircleDrawer final : public ShapeDrawer
+{
+public:
+    int width(int row) const override
+    {
+        return 2 * row - 1;
+    }
+
+    int spans(int row, int i, Span* runs) const override
+    {
+        int half = discHalfWidth(row, i, row / 2.0);
+        runs[0] = {row - 1 - half, row + half, '*', 1};
+        return 1;
+    }
+};
+
+// Diamond drawer implementation
+class DiamondDrawer final : public ShapeDrawer
+{
+public:
+    int width(int row) const override
+    {
+        return 2 * ((row - 1) / 2) + 1;
+    }
+
+    int spans(int row, int i, Span* runs) const override
+    {
+        // Widens like the triangle down to the middle line, then narrows again
+        int centre = (row - 1) / 2;
+        int half = min(i, row - 1 - i);
+        runs[0] = {centre - half, centre + half + 1, '*', 1};
+        return 1;
+    }
+};
+
+// Ring drawer implementation
+class RingDrawer final : public ShapeDrawer
+{
+public:
+    int width(int row) const override
+    {
+        return 2 * row - 1;
+    }
+
+    int spans(int row, int i, Span* runs) const override
+    {
+        double outer = row / 2.0;
+        double inner = outer - max(1.0, row / 8.0); // Band a quarter of the radius thick
+        int centre = row - 1;
+        int outerHalf = discHalfWidth(row, i, outer);
+        double y = i + 0.5 - outer;
+        if (inner <= 0.0 || fabs(y) >= inner)
+        {
+            // Top and bottom of the band: one solid run
+            runs[0] = {centre - outerHalf, centre + outerHalf + 1, 'o', 1};
+            return 1;
+        }
+
+        // Through the hole: a run on each side
+        int innerHalf = min(discHalfWidth(row, i, inner), outerHalf - 1);
+        runs[0] = {centre - outerHalf, centre - innerHalf, 'o', 1};
+        runs[1] = {centre + innerHalf + 1, centre + outerHalf + 1, 'o', 1};
+        return 2;
+    }
+};
 
 // Function pointer type definition
 typedef void (*DrawFunction)(int);
@@ -107,6 +435,9 @@ typedef void (*DrawFunction)(int);
 // Singleton instances of shape drawers
 static TriangleDrawer triangleDrawer;
 static SquareDrawer squareDrawer;
+static CircleDrawer circleDrawer;
+static DiamondDrawer diamondDrawer;
+static RingDrawer ringDrawer;
 
 // Drawing functions that can be passed as function pointers
 void DrawTriangle(int row) 
@@ -119,21 +450,978 @@ void DrawSquare(int row)
     squareDrawer(row);
 }
 
-// Generic drawing function that accepts any drawing function pointer
+void DrawCircle(int row)
+{
+    circleDrawer(row);
+}
+
+void DrawDiamond(int row)
+{
+    diamondDrawer(row);
+}
+
+void DrawRing(int row)
+{
+    ringDrawer(row);
+}
+
+// Stream buffer that passes everything on to target and keeps a copy of it
+// until the copy would exceed limit bytes
+class TeeBuffer : public streambuf
+{
+private:
+    streambuf* target;  // Where the output really goes
+    string copy;        // Everything written so far
+    size_t limit;       // Largest copy worth keeping
+    bool overflowed;    // Set once the copy has been given up
+
+    void keep(const char* bytes, size_t count)
+    {
+        if (overflowed)
+        {
+            return;
+        }
+        if (copy.size() + count > limit)
+        {
+            overflowed = true;
+            string().swap(copy);
+            return;
+        }
+        copy.append(bytes, count);
+    }
+
+protected:
+    int overflow(int c) override
+    {
+        if (c == traits_type::eof())
+        {
+            return traits_type::not_eof(c);
+        }
+        char ch = static_cast<char>(c);
+        keep(&ch, 1);
+        return target->sputc(ch);
+    }
+
+    streamsize xsputn(const char* bytes, streamsize count) override
+    {
+        keep(bytes, static_cast<size_t>(count));
+        return target->sputn(bytes, count);
+    }
+
+    int sync() override
+    {
+        return target->pubsync();
+    }
+
+public:
+    TeeBuffer(streambuf* target, size_t limit) : target(target), limit(limit), overflowed(false) {}
+
+    // The copy, or nullptr if the output outgrew the limit; callers may move it out
+    string* captured()
+    {
+        return overflowed ? nullptr : &copy;
+    }
+};
+
+// Rendered output of recent draws keyed by drawing function and row, evicting
+// the least recently used entries once their total size passes a byte bound.
+// Draws go through cout, so the cache must only be used from one thread.
+class ShapeCache
+{
+private:
+    struct Key
+    {
+        DrawFunction drawer;  // Drawing function
+        int row;              // Size it was drawn at
+
+        bool operator==(const Key& other) const
+        {
+            return drawer == other.drawer && row == other.row;
+        }
+    };
+
+    struct KeyHash
+    {
+        size_t operator()(const Key& key) const
+        {
+            return hash<DrawFunction>()(key.drawer) * 31 + hash<int>()(key.row);
+        }
+    };
+
+    struct Entry
+    {
+        Key key;        // What was drawn
+        string output;  // What it printed
+    };
+
+    list<Entry> entries;                                          // Most recently used first
+    unordered_map<Key, list<Entry>::iterator, KeyHash> index;    // Entry of each key
+    size_t capacity;                                              // Byte bound on all outputs
+    size_t bytes;                                                 // Bytes currently held
+    long long hitCount;                                           // Draws answered from the cache
+    long long missCount;                                          // Draws that had to render
+
+    void evict()
+    {
+        while (bytes > capacity && !entries.empty())
+        {
+            bytes -= entries.back().output.size();
+            index.erase(entries.back().key);
+            entries.pop_back();
+        }
+    }
+
+public:
+    explicit ShapeCache(size_t capacity = 16 * 1024 * 1024) :
+        capacity(capacity), bytes(0), hitCount(0), missCount(0) {}
+
+    // Draw to cout, replaying a cached rendering when there is one
+    void draw(DrawFunction drawer, int row)
+    {
+        Key key = {drawer, row};
+        auto found = index.find(key);
+        if (found != index.end())
+        {
+            hitCount++;
+            entries.splice(entries.begin(), entries, found->second); // Now most recently used
+            const string& output = found->second->output;
+            cout.write(output.data(), output.size());
+            cout.flush();
+            return;
+        }
+
+        missCount++;
+        TeeBuffer tee(cout.rdbuf(), capacity);
+        streambuf* original = cout.rdbuf(&tee);
+        try
+        {
+            drawer(row);
+        }
+        catch (...)
+        {
+            cout.rdbuf(original);
+            throw;
+        }
+        cout.rdbuf(original);
+
+        string* output = tee.captured();
+        if (output != nullptr)
+        {
+            bytes += output->size();
+            entries.push_front({key, std::move(*output)}); // Take the copy rather than duplicate it
+            index[key] = entries.begin();
+            evict();
+        }
+    }
+
+    // Drop every entry, keeping the counters
+    void clear()
+    {
+        entries.clear();
+        index.clear();
+        bytes = 0;
+    }
+
+    long long hits() const { return hitCount; }
+    long long misses() const { return missCount; }
+    size_t size() const { return bytes; }
+    int count() const { return static_cast<int>(entries.size()); }
+};
+
+// Cache shared by every Draw call
+static ShapeCache& shapeCache()
+{
+    static ShapeCache cache;
+    return cache;
+}
+
+// Generic drawing function that accepts any drawing function pointer;
+// repeated draws of the same shape and size are replayed from shapeCache()
 void Draw(DrawFunction drawer, int row) 
 {
-    drawer(row);
+    shapeCache().draw(drawer, row);
 }
 
-int main()
+// Bytes of output per band handed to one worker
+const size_t BAND_BYTES = 256 * 1024;
+
+// Shapes with at least this many rows are drawn in parallel bands
+const int PARALLEL_ROWS = 2048;
+
+// Pool shared by every drawer, started on first use
+static ThreadPool& renderPool()
+{
+    static ThreadPool pool;
+    return pool;
+}
+
+void ShapeDrawer::operator()(int row) const
+{
+    if (row >= PARALLEL_ROWS && renderPool().size() > 1)
+    {
+        renderParallel(row, cout, renderPool());
+    }
+    else
+    {
+        render(row, cout);
+    }
+}
+
+// Bands are rasterized by the pool into a ring of window slots, at most two
+// per worker ahead of the writer, so memory stays bounded however tall the
+// shape is; the calling thread writes each band as soon as it and all bands
+// above it are ready
+void ShapeDrawer::renderParallel(int row, ostream& out, ThreadPool& pool) const
+{
+    if (row <= 0)
+    {
+        return;
+    }
+
+    struct Band
+    {
+        vector<char> bytes;   // Room for the rows of one band
+        size_t used;          // Bytes rasterized into bytes
+        bool ready;           // Set by the worker once bytes is complete
+        exception_ptr error;  // Failure raised while rasterizing
+    };
+
+    size_t lineBytes = static_cast<size_t>(width(row)) + 1; // Room for the newline
+    int rowsPerBand = static_cast<int>(max<size_t>(1, BAND_BYTES / lineBytes));
+    int bands = (row + rowsPerBand - 1) / rowsPerBand;
+    int window = min(bands, 2 * pool.size());
+
+    vector<Band> slots(window);
+    for (Band& band : slots)
+    {
+        band.bytes.resize(lineBytes * rowsPerBand);
+    }
+    mutex doneLock;
+    condition_variable bandDone;
+    int inFlight = 0;
+    int submitted = 0;
+    exception_ptr failure;
+
+    for (int emitted = 0; emitted < bands; emitted++)
+    {
+        // Keep the window full
+        for (; submitted < bands && submitted < emitted + window; submitted++)
+        {
+            Band& band = slots[submitted % window];
+            band.ready = false;
+            band.error = nullptr;
+            {
+                lock_guard<mutex> guard(doneLock);
+                inFlight++;
+            }
+            int first = submitted * rowsPerBand;
+            int last = min(row, first + rowsPerBand);
+            pool.submit([this, &band, &doneLock, &bandDone, &inFlight, row, first, last, lineBytes]()
+            {
+                exception_ptr error;
+                try
+                {
+                    size_t used = 0;
+                    for (int i = first; i < last; i++)
+                    {
+                        used += rasterizeRow(row, i, band.bytes.data() + used);
+                        band.bytes[used++] = '\n';
+                    }
+                    band.used = used;
+                }
+                catch (...)
+                {
+                    error = current_exception();
+                }
+
+                lock_guard<mutex> guard(doneLock);
+                band.error = error;
+                band.ready = true;
+                inFlight--;
+                bandDone.notify_all();
+            });
+        }
+
+        Band& band = slots[emitted % window];
+        {
+            unique_lock<mutex> guard(doneLock);
+            bandDone.wait(guard, [&band]() { return band.ready; });
+        }
+        if (band.error)
+        {
+            failure = band.error;
+            break;
+        }
+        out.write(band.bytes.data(), band.used);
+    }
+
+    // Workers hold references into slots, so let them all finish before leaving
+    unique_lock<mutex> guard(doneLock);
+    bandDone.wait(guard, [&inFlight]() { return inFlight == 0; });
+    if (failure)
+    {
+        rethrow_exception(failure);
+    }
+    out.flush();
+}
+
+// Write the part of a line between columns from and to (exclusive) into
+// segment, returning how many bytes of the line fall in that window
+static int fillSpansClipped(const Span* runs, int count, int from, int to, char* segment)
 {
+    int length = (count > 0) ? min(runs[count - 1].end, to) : from;
+    if (length <= from)
+    {
+        return 0;
+    }
+
+    memset(segment, ' ', length - from);
+    for (int k = 0; k < count; k++)
+    {
+        int lo = max(runs[k].start, from);
+        int hi = min(runs[k].end, to);
+        if (lo >= hi)
+        {
+            continue;
+        }
+
+        char* cells = segment + (lo - from);
+        int cellCount = hi - lo;
+        if (runs[k].step <= 1)
+        {
+            memset(cells, runs[k].ch, cellCount);
+            continue;
+        }
+
+        // One period in the phase of the run, then doubled; cells between stay spaces
+        int period = min(runs[k].step, cellCount);
+        for (int j = 0; j < period; j++)
+        {
+            if ((lo + j - runs[k].start) % runs[k].step == 0)
+            {
+                cells[j] = runs[k].ch;
+            }
+        }
+        for (int done = period; done < cellCount; done *= 2)
+        {
+            memcpy(cells + done, cells, min(done, cellCount - done));
+        }
+    }
+    return length - from;
+}
+
+// Pull-style generator that hands out a shape in chunks of at most one
+// fixed buffer; a line wider than the buffer is split over several chunks
+class RowGenerator
+{
+private:
+    const ShapeDrawer& drawer;  // Shape being generated
+    int row;                    // Size of the shape
+    int line;                   // Line being generated
+    int column;                 // Next column of that line
+    int lineLength;             // Length of that line without the newline
+    bool loaded;                // Set once runs holds the spans of line
+    Span runs[MAX_SPANS];       // Spans of line
+    int runCount;               // Number of spans in runs
+    vector<char> buffer;        // Reused for every chunk
+
+public:
+    RowGenerator(const ShapeDrawer& drawer, int row, size_t bufferBytes = RENDER_BUFFER_BYTES) :
+        drawer(drawer), row(row), line(0), column(0), lineLength(0), loaded(false), runCount(0),
+        buffer(max<size_t>(bufferBytes, 1)) {}
+
+    // Point bytes at the next chunk and return its size, or 0 once the shape is done;
+    // the chunk stays valid until the next call
+    size_t next(const char*& bytes)
+    {
+        size_t used = 0;
+        while (line < row && used < buffer.size())
+        {
+            if (!loaded)
+            {
+                runCount = drawer.spans(row, line, runs);
+                lineLength = (runCount > 0) ? runs[runCount - 1].end : 0;
+                loaded = true;
+            }
+
+            if (column < lineLength)
+            {
+                int room = static_cast<int>(min<size_t>(buffer.size() - used, lineLength - column));
+                used += fillSpansClipped(runs, runCount, column, column + room, buffer.data() + used);
+                column += room;
+                continue;
+            }
+
+            buffer[used++] = '\n';
+            line++;
+            column = 0;
+            loaded = false;
+        }
+        bytes = buffer.data();
+        return used;
+    }
+};
+
+// Destination of streamed rows; write() may block until the consumer catches up
+class RowSink
+{
+public:
+    virtual ~RowSink() {}
+    virtual void write(const char* bytes, size_t count) = 0;
+    virtual void close() {} // No more writes will follow
+};
+
+void ShapeDrawer::stream(int row, RowSink& sink) const
+{
+    RowGenerator generator(*this, row);
+    const char* bytes;
+    try
+    {
+        for (size_t count; (count = generator.next(bytes)) > 0; )
+        {
+            sink.write(bytes, count);
+        }
+    }
+    catch (...)
+    {
+        sink.close();
+        throw;
+    }
+    sink.close();
+}
+
+// Sink writing to an ostream
+class StreamSink : public RowSink
+{
+private:
+    ostream& out;
+
+public:
+    explicit StreamSink(ostream& out) : out(out) {}
+
+    void write(const char* bytes, size_t count) override
+    {
+        out.write(bytes, count);
+    }
+
+    void close() override
+    {
+        out.flush();
+    }
+};
+
+#ifdef __linux__
+// Sink writing straight to a file descriptor; a full pipe or socket blocks write(2)
+class FdSink : public RowSink
+{
+private:
+    int fd;
+
+public:
+    explicit FdSink(int fd) : fd(fd) {}
+
+    void write(const char* bytes, size_t count) override
+    {
+        while (count > 0)
+        {
+            ssize_t written = ::write(fd, bytes, count);
+            if (written < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                throw system_error(errno, generic_category(), "FdSink::write(): write failed");
+            }
+            bytes += written;
+            count -= written;
+        }
+    }
+};
+#endif // __linux__
+
+// Bounded in-memory pipe between a producer writing through the RowSink
+// interface and a consumer calling read(); write() blocks while the ring is
+// full. A consumer that stops early must call cancel() (or read through a
+// PipeReader), which makes the blocked write() throw like a broken pipe
+class PipeSink : public RowSink
+{
+private:
+    vector<char> ring;              // Bytes in flight
+    size_t head;                    // Next byte to read
+    size_t size;                    // Bytes waiting to be read
+    bool closed;                    // Set once the producer is done
+    bool cancelled;                 // Set once the consumer has stopped reading
+    mutex lock;                     // Guards the fields above
+    condition_variable notFull;     // Signals room in the ring
+    condition_variable notEmpty;    // Signals data or close
+
+public:
+    explicit PipeSink(size_t capacity = 64 * 1024) :
+        ring(max<size_t>(capacity, 1)), head(0), size(0), closed(false), cancelled(false) {}
+
+    void write(const char* bytes, size_t count) override
+    {
+        while (count > 0)
+        {
+            unique_lock<mutex> guard(lock);
+            notFull.wait(guard, [this]() { return size < ring.size() || cancelled; });
+            if (cancelled)
+            {
+                throw system_error(EPIPE, generic_category(), "PipeSink::write(): Reader cancelled");
+            }
+            size_t tail = (head + size) % ring.size();
+            size_t n = min({count, ring.size() - size, ring.size() - tail});
+            memcpy(ring.data() + tail, bytes, n);
+            size += n;
+            bytes += n;
+            count -= n;
+            notEmpty.notify_one();
+        }
+    }
+
+    void close() override
+    {
+        lock_guard<mutex> guard(lock);
+        closed = true;
+        notEmpty.notify_all();
+    }
+
+    // Stop reading: pending and future writes throw instead of blocking
+    void cancel()
+    {
+        lock_guard<mutex> guard(lock);
+        cancelled = true;
+        notFull.notify_all();
+        notEmpty.notify_all();
+    }
+
+    // Copy up to count bytes into bytes, blocking until some arrive; 0 means
+    // the producer closed the pipe and everything has been read, or the
+    // pipe was cancelled
+    size_t read(char* bytes, size_t count)
+    {
+        unique_lock<mutex> guard(lock);
+        notEmpty.wait(guard, [this]() { return size > 0 || closed || cancelled; });
+        if (cancelled)
+        {
+            return 0;
+        }
+        size_t n = min({count, size, ring.size() - head});
+        memcpy(bytes, ring.data() + head, n);
+        head = (head + n) % ring.size();
+        size -= n;
+        notFull.notify_one();
+        return n;
+    }
+};
+
+// Consumer end of a PipeSink that cancels the pipe when it goes out of scope,
+// so a reader leaving early, or by an exception, never strands the producer
+class PipeReader
+{
+private:
+    PipeSink& pipe;
+
+public:
+    explicit PipeReader(PipeSink& pipe) : pipe(pipe) {}
+    ~PipeReader() { pipe.cancel(); }
+    PipeReader(const PipeReader&) = delete;
+    PipeReader& operator=(const PipeReader&) = delete;
+
+    size_t read(char* bytes, size_t count)
+    {
+        return pipe.read(bytes, count);
+    }
+};
+
+// Render a Drawer with every per-row call bound at compile time; the drawers
+// are final and called by qualified name, so spans() inlines into the row loop
+template <typename Drawer>
+void renderShape(int row, ostream& out)
+{
+    static_assert(is_base_of<ShapeDrawer, Drawer>::value, "renderShape(): Drawer must be a ShapeDrawer");
+    if (row <= 0)
+    {
+        return;
+    }
+
+    const Drawer drawer{};
+    size_t lineBytes = static_cast<size_t>(drawer.Drawer::width(row)) + 1; // Room for the newline
+    writeRows(row, lineBytes, out, [&drawer, row](int i, char* line)
+    {
+        Span runs[MAX_SPANS];
+        return fillSpans(runs, drawer.Drawer::spans(row, i, runs), line);
+    });
+}
+
+// Draw a Drawer to out, in bands on the render pool once the shape is large
+template <typename Drawer>
+void drawShape(int row, ostream& out)
+{
+    if (row >= PARALLEL_ROWS && renderPool().size() > 1)
+    {
+        const Drawer drawer{};
+        drawer.renderParallel(row, out, renderPool());
+    }
+    else
+    {
+        renderShape<Drawer>(row, out);
+    }
+}
+
+// Statically dispatched drawing, e.g. Draw<TriangleDrawer>(row)
+template <typename Drawer>
+void Draw(int row)
+{
+    drawShape<Drawer>(row, cout);
+}
+
+// Renderer of one shape kind, as stored in the registry
+typedef void (*RenderFunction)(int, ostream&);
+
+// The one instance of Drawer the registry hands out for streaming
+template <typename Drawer>
+const ShapeDrawer& shapeInstance()
+{
+    static const Drawer drawer{};
+    return drawer;
+}
+
+// Shapes drawable by name; each entry points straight at drawShape<Drawer>,
+// so a draw costs one indirect call rather than one per row and takes the
+// same serial or parallel path as Draw<Drawer>. The entry also keeps the
+// drawer itself, so the same names can be streamed
+class ShapeRegistry
+{
+private:
+    struct Entry
+    {
+        RenderFunction render;       // Statically dispatched renderer
+        const ShapeDrawer* drawer;   // Instance for streaming through a RowSink
+    };
+
+    unordered_map<string, Entry> shapes;  // Entry of each name
+
+    const Entry& find(const string& name, const char* caller) const
+    {
+        auto found = shapes.find(name);
+        if (found == shapes.end())
+        {
+            throw invalid_argument(string(caller) + ": Unknown shape " + name);
+        }
+        return found->second;
+    }
+
+public:
+    // Make Drawer available as name, replacing any shape already there
+    template <typename Drawer>
+    void add(const string& name)
+    {
+        shapes[name] = Entry{&drawShape<Drawer>, &shapeInstance<Drawer>()};
+    }
+
+    bool contains(const string& name) const
+    {
+        return shapes.count(name) != 0;
+    }
+
+    // Draw the named shape to out
+    void draw(const string& name, int row, ostream& out = cout) const
+    {
+        find(name, "ShapeRegistry::draw()").render(row, out);
+    }
+
+    // Stream the named shape to sink in constant memory
+    void stream(const string& name, int row, RowSink& sink) const
+    {
+        find(name, "ShapeRegistry::stream()").drawer->stream(row, sink);
+    }
+
+    // Registered names in sorted order
+    vector<string> names() const
+    {
+        vector<string> result;
+        for (const auto& entry : shapes)
+        {
+            result.push_back(entry.first);
+        }
+        sort(result.begin(), result.end());
+        return result;
+    }
+};
+
+// Registry holding the built-in shapes, filled once by the thread-safe
+// initialization of the function-local static
+static ShapeRegistry& shapeRegistry()
+{
+    static ShapeRegistry registry = []()
+    {
+        ShapeRegistry shapes;
+        shapes.add<TriangleDrawer>("triangle");
+        shapes.add<SquareDrawer>("square");
+        shapes.add<CircleDrawer>("circle");
+        shapes.add<DiamondDrawer>("diamond");
+        shapes.add<RingDrawer>("ring");
+        return shapes;
+    }();
+    return registry;
+}
+
+// Stream buffer that discards everything, so benchmarks time rendering rather than the terminal
+class NullBuffer : public streambuf
+{
+protected:
+    int overflow(int c) override
+    {
+        return c;
+    }
+
+    streamsize xsputn(const char*, streamsize count) override
+    {
+        return count;
+    }
+};
+
+// Rows per second of the per-cell and buffered paths for one drawer
+void benchmarkDrawer(const char* name, const ShapeDrawer& drawer, int row)
+{
+    NullBuffer sink;
+    ostream out(&sink);
+
+    auto start = chrono::steady_clock::now();
+    drawer.drawPerCell(row, out);
+    double perCell = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    start = chrono::steady_clock::now();
+    drawer.render(row, out);
+    double buffered = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    cout << name << " (row = " << row << "): per-cell " << row / perCell << " rows/s, buffered "
+         << row / buffered << " rows/s (" << perCell / buffered << "x)" << endl;
+}
+
+// Rows per second of the buffered path against banded rendering on pools of increasing size
+void benchmarkParallel(const char* name, const ShapeDrawer& drawer, int row)
+{
+    NullBuffer sink;
+    ostream out(&sink);
+
+    auto start = chrono::steady_clock::now();
+    drawer.render(row, out);
+    double serial = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cout << name << " (row = " << row << "): buffered " << row / serial << " rows/s";
+
+    int cores = max(1, static_cast<int>(thread::hardware_concurrency()));
+    for (int threads = 1; ; threads = min(threads * 2, cores))
+    {
+        ThreadPool pool(threads);
+        start = chrono::steady_clock::now();
+        drawer.renderParallel(row, out, pool);
+        double banded = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        cout << ", " << threads << " thread(s) " << row / banded << " rows/s";
+        if (threads == cores)
+        {
+            break;
+        }
+    }
+    cout << endl;
+}
+
+// Time repeated draws of a few shapes through the cache against drawing them every time
+void benchmarkCache(int row, int repeats)
+{
+    NullBuffer sink;
+    streambuf* original = cout.rdbuf(&sink);
+    DrawFunction drawers[] = {DrawTriangle, DrawSquare, DrawCircle};
+
+    auto start = chrono::steady_clock::now();
+    for (int r = 0; r < repeats; r++)
+    {
+        for (DrawFunction drawer : drawers)
+        {
+            drawer(row);
+        }
+    }
+    double direct = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    ShapeCache cache;
+    start = chrono::steady_clock::now();
+    for (int r = 0; r < repeats; r++)
+    {
+        for (DrawFunction drawer : drawers)
+        {
+            cache.draw(drawer, row);
+        }
+    }
+    double cached = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    cout.rdbuf(original);
+
+    cout << "Cache (row = " << row << ", " << repeats << " repeats of 3 shapes): uncached " << direct
+         << " ms, cached " << cached << " ms, " << cache.hits() << " hits, " << cache.misses()
+         << " misses, " << cache.size() << " bytes held" << endl;
+}
+
+// Time many small draws through the function pointer and virtual calls,
+// the templated Draw<Drawer> and the registry
+void benchmarkDispatch(int row, int repeats)
+{
+    NullBuffer sink;
+    streambuf* original = cout.rdbuf(&sink);
+    DrawFunction pointer = DrawTriangle;
+    const ShapeRegistry& registry = shapeRegistry();
+
+    auto start = chrono::steady_clock::now();
+    for (int r = 0; r < repeats; r++)
+    {
+        pointer(row);
+    }
+    double indirect = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    start = chrono::steady_clock::now();
+    for (int r = 0; r < repeats; r++)
+    {
+        Draw<TriangleDrawer>(row);
+    }
+    double templated = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    start = chrono::steady_clock::now();
+    for (int r = 0; r < repeats; r++)
+    {
+        registry.draw("triangle", row);
+    }
+    double registered = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    cout.rdbuf(original);
+
+    cout << "Dispatch (triangle, row = " << row << ", " << repeats << " draws): function pointer " << indirect
+         << " ms, Draw<TriangleDrawer> " << templated << " ms, registry " << registered << " ms" << endl;
+}
+
+// Stream a shape through a small PipeSink to a consumer thread that only
+// counts the bytes, so the producer is held back by the pipe alone
+void benchmarkStream(const char* name, const ShapeDrawer& drawer, int row)
+{
+    PipeSink pipe(16 * 1024);
+    long long bytes = 0;
+    thread consumer([&pipe, &bytes]()
+    {
+        PipeReader reader(pipe);
+        vector<char> chunk(4096);
+        for (size_t n; (n = reader.read(chunk.data(), chunk.size())) > 0; )
+        {
+            bytes += n;
+        }
+    });
+
+    auto start = chrono::steady_clock::now();
+    drawer.stream(row, pipe);
+    consumer.join();
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cout << name << " streamed (row = " << row << "): " << bytes << " bytes through a 16 KiB pipe, "
+         << row / seconds << " rows/s, " << bytes / seconds / 1e6 << " MB/s" << endl;
+}
+
+// Print how to call the program, with the registered shape names; returns the exit status
+static int usage(const char* program)
+{
+    cerr << "Usage: " << program << " [--bench [row] | --shape name | --stream name row]" << endl << "Shapes:";
+    for (const string& name : shapeRegistry().names())
+    {
+        cerr << " " << name;
+    }
+    cerr << endl;
+    return 1;
+}
+
+// Run with --bench [row] to time the renderers instead of reading row from cin,
+// with --shape name to draw one registered shape, or with --stream name row
+// to stream a shape of any size to stdout in constant memory
+int main(int argc, char* argv[])
+{
+    if (argc > 1 && string(argv[1]) == "--bench") 
+    {
+        int row = 5000;
+        try
+        {
+            row = (argc > 2) ? stoi(argv[2]) : row;
+        }
+        catch (const logic_error&)
+        {
+            return usage(argv[0]); // Not a number, or out of range
+        }
+        benchmarkDrawer("Triangle", triangleDrawer, row);
+        benchmarkDrawer("Square", squareDrawer, row);
+        benchmarkDrawer("Circle", circleDrawer, row);
+        benchmarkDrawer("Diamond", diamondDrawer, row);
+        benchmarkDrawer("Ring", ringDrawer, row);
+
+        int bigRow = 4 * row;
+        benchmarkParallel("Triangle", triangleDrawer, bigRow);
+        benchmarkParallel("Square", squareDrawer, bigRow);
+        benchmarkParallel("Circle", circleDrawer, bigRow);
+
+        benchmarkCache(200, 2000);
+        benchmarkDispatch(50, 20000);
+
+        benchmarkStream("Square", squareDrawer, bigRow);
+        benchmarkStream("Ring", ringDrawer, bigRow);
+        return 0;
+    }
+
+    if (argc > 1 && ((string(argv[1]) == "--shape" && argc < 3) || (string(argv[1]) == "--stream" && argc < 4)))
+    {
+        return usage(argv[0]);
+    }
+
+    if (argc > 3 && string(argv[1]) == "--stream")
+    {
+        int row;
+        try
+        {
+            row = stoi(argv[3]);
+        }
+        catch (const logic_error&)
+        {
+            return usage(argv[0]); // Not a number, or out of range
+        }
+#ifdef __linux__
+        FdSink sink(STDOUT_FILENO);
+#else
+        StreamSink sink(cout);
+#endif
+        try
+        {
+            shapeRegistry().stream(argv[2], row, sink);
+        }
+        catch (const invalid_argument& e)
+        {
+            cerr << e.what() << endl;
+            return 1;
+        }
+        return 0;
+    }
+
     int row; // numbers of shape's row
 
     cin >> row;
+    if (argc > 2 && string(argv[1]) == "--shape")
+    {
+        try
+        {
+            shapeRegistry().draw(argv[2], row);
+        }
+        catch (const invalid_argument& e)
+        {
+            cerr << e.what() << endl;
+            return 1;
+        }
+        return 0;
+    }
+
     Draw(DrawTriangle, row);
 
     cout << endl << endl;
     Draw(DrawSquare, row);
 
     return 0;
-}
\ No newline at end of file
+}
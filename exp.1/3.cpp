@@ -20,6 +20,20 @@ Output is:
 #include <cmath>
 #include <string>
 #include <stdexcept>
+#include <vector>
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+#include <cstdint>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <exception>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CCIRCLE_X86 1
+#endif
 
 using namespace std;
 
@@ -52,6 +66,7 @@ public:
     // Member functions
     double distance(const CCircle& other) const; // Calculate distance between centers of two circles
     Relation determineRelation(const CCircle& other) const; // Determine relationship between two circles
+    static Relation classifySquared(double distanceSquared, double radius1, double radius2); // Relationship from the squared centre distance
     string relationToString(Relation relation) const; // Convert relationship enum to string
     string relationship(const CCircle& other) const; // Public interface for relationship determination
     
@@ -59,6 +74,7 @@ public:
     double getRadius() const { return radius; } // Get radius
     double getX() const { return x; } // Get X-coordinate
     double getY() const { return y; } // Get Y-coordinate
+    static double epsilon() { return EPSILON; } // Get comparison threshold
 };
 
 // Constructor with radius and center coordinates
@@ -113,6 +129,49 @@ CCircle::Relation CCircle::determineRelation(const CCircle& other) const
     }
 }
 
+// Determine the relationship from the squared distance between centres, in the
+// same order as determineRelation but without a square root: each test
+// |d - a| < EPSILON becomes (a - EPSILON)^2 < d^2 < (a + EPSILON)^2, where the
+// lower bound drops out when a < EPSILON because d is never negative
+CCircle::Relation CCircle::classifySquared(double distanceSquared, double radius1, double radius2)
+{
+    double sumRadii = radius1 + radius2;
+    double diffRadii = fabs(radius1 - radius2);
+    double sumLow = sumRadii - EPSILON;
+    double diffLow = diffRadii - EPSILON;
+
+    if (distanceSquared < EPSILON * EPSILON && diffRadii < EPSILON) 
+    {
+        return Relation::COINCIDE;
+    }
+    else if (distanceSquared > sumRadii * sumRadii) 
+    {
+        return Relation::SEPARATED;
+    }
+    else if (distanceSquared < (sumRadii + EPSILON) * (sumRadii + EPSILON) &&
+             (sumLow < 0 || distanceSquared > sumLow * sumLow)) 
+    {
+        return Relation::CIRCUMSCRIBE;
+    }
+    else if (distanceSquared < sumRadii * sumRadii && distanceSquared > diffRadii * diffRadii) 
+    {
+        return Relation::OVERLAPPED;
+    }
+    else if (distanceSquared < (diffRadii + EPSILON) * (diffRadii + EPSILON) &&
+             (diffLow < 0 || distanceSquared > diffLow * diffLow)) 
+    {
+        return Relation::INSCRIBE;
+    }
+    else if (distanceSquared < diffRadii * diffRadii) 
+    {
+        return Relation::CONTAINED;
+    }
+    else 
+    {
+        return Relation::OTHER;
+    }
+}
+
 // Convert relationship enum to string representation
 string CCircle::relationToString(Relation relation) const
 {
@@ -136,9 +195,655 @@ string CCircle::relationship(const CCircle& other) const
     return relationToString(relation);
 }
 
+// Circles stored structure-of-arrays, so batch kernels can load several
+// centres and radii with single vector loads
+struct CircleBatch
+{
+    vector<double> x;       // X-coordinates of centres
+    vector<double> y;       // Y-coordinates of centres
+    vector<double> radius;  // Radii
+
+    void add(const CCircle& circle)
+    {
+        x.push_back(circle.getX());
+        y.push_back(circle.getY());
+        radius.push_back(circle.getRadius());
+    }
+
+    int size() const { return static_cast<int>(x.size()); }
+};
+
+// Relation of pairs i of two coordinate arrays, or of one circle (stride 0) against many
+typedef void (*RelationKernel)(const double* x1, const double* y1, const double* r1, int stride1,
+                               const double* x2, const double* y2, const double* r2,
+                               int count, CCircle::Relation* out);
+
+// Portable kernel: one pair at a time through classifySquared
+static void relateScalar(const double* x1, const double* y1, const double* r1, int stride1,
+                         const double* x2, const double* y2, const double* r2,
+                         int count, CCircle::Relation* out)
+{
+    for (int i = 0; i < count; i++)
+    {
+        int j = i * stride1;
+        double dx = x1[j] - x2[i];
+        double dy = y1[j] - y2[i];
+        out[i] = CCircle::classifySquared(dx * dx + dy * dy, r1[j], r2[i]);
+    }
+}
+
+#ifdef CCIRCLE_X86
+// AVX2 kernel: four pairs per step. Every test of classifySquared is taken as
+// a lane mask and the relation codes are blended from lowest to highest
+// priority, so the first matching test wins as in the if-else chain.
+__attribute__((target("avx2")))
+static void relateAvx2(const double* x1, const double* y1, const double* r1, int stride1,
+                       const double* x2, const double* y2, const double* r2,
+                       int count, CCircle::Relation* out)
+{
+    const double eps = CCircle::epsilon();
+    const __m256d epsilon = _mm256_set1_pd(eps);
+    const __m256d epsilonSquared = _mm256_set1_pd(eps * eps);
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d signBit = _mm256_set1_pd(-0.0);
+    const __m256d otherCode = _mm256_set1_pd(static_cast<int>(CCircle::Relation::OTHER));
+    const __m256d containedCode = _mm256_set1_pd(static_cast<int>(CCircle::Relation::CONTAINED));
+    const __m256d inscribeCode = _mm256_set1_pd(static_cast<int>(CCircle::Relation::INSCRIBE));
+    const __m256d overlappedCode = _mm256_set1_pd(static_cast<int>(CCircle::Relation::OVERLAPPED));
+    const __m256d circumscribeCode = _mm256_set1_pd(static_cast<int>(CCircle::Relation::CIRCUMSCRIBE));
+    const __m256d separatedCode = _mm256_set1_pd(static_cast<int>(CCircle::Relation::SEPARATED));
+    const __m256d coincideCode = _mm256_set1_pd(static_cast<int>(CCircle::Relation::COINCIDE));
+
+    int i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m256d ax, ay, ar;
+        if (stride1 == 0)
+        {
+            ax = _mm256_broadcast_sd(x1);
+            ay = _mm256_broadcast_sd(y1);
+            ar = _mm256_broadcast_sd(r1);
+        }
+        else
+        {
+            ax = _mm256_loadu_pd(x1 + i);
+            ay = _mm256_loadu_pd(y1 + i);
+            ar = _mm256_loadu_pd(r1 + i);
+        }
+        __m256d br = _mm256_loadu_pd(r2 + i);
+        __m256d dx = _mm256_sub_pd(ax, _mm256_loadu_pd(x2 + i));
+        __m256d dy = _mm256_sub_pd(ay, _mm256_loadu_pd(y2 + i));
+        __m256d d2 = _mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy));
+
+        __m256d sum = _mm256_add_pd(ar, br);
+        __m256d diff = _mm256_andnot_pd(signBit, _mm256_sub_pd(ar, br));
+        __m256d sum2 = _mm256_mul_pd(sum, sum);
+        __m256d diff2 = _mm256_mul_pd(diff, diff);
+        __m256d sumHigh = _mm256_add_pd(sum, epsilon);
+        __m256d sumLow = _mm256_sub_pd(sum, epsilon);
+        __m256d diffHigh = _mm256_add_pd(diff, epsilon);
+        __m256d diffLow = _mm256_sub_pd(diff, epsilon);
+
+        __m256d coincide = _mm256_and_pd(_mm256_cmp_pd(d2, epsilonSquared, _CMP_LT_OQ),
+                                         _mm256_cmp_pd(diff, epsilon, _CMP_LT_OQ));
+        __m256d separated = _mm256_cmp_pd(d2, sum2, _CMP_GT_OQ);
+        __m256d circumscribe = _mm256_and_pd(
+            _mm256_cmp_pd(d2, _mm256_mul_pd(sumHigh, sumHigh), _CMP_LT_OQ),
+            _mm256_or_pd(_mm256_cmp_pd(sumLow, zero, _CMP_LT_OQ),
+                         _mm256_cmp_pd(d2, _mm256_mul_pd(sumLow, sumLow), _CMP_GT_OQ)));
+        __m256d overlapped = _mm256_and_pd(_mm256_cmp_pd(d2, sum2, _CMP_LT_OQ),
+                                           _mm256_cmp_pd(d2, diff2, _CMP_GT_OQ));
+        __m256d inscribe = _mm256_and_pd(
+            _mm256_cmp_pd(d2, _mm256_mul_pd(diffHigh, diffHigh), _CMP_LT_OQ),
+            _mm256_or_pd(_mm256_cmp_pd(diffLow, zero, _CMP_LT_OQ),
+                         _mm256_cmp_pd(d2, _mm256_mul_pd(diffLow, diffLow), _CMP_GT_OQ)));
+        __m256d contained = _mm256_cmp_pd(d2, diff2, _CMP_LT_OQ);
+
+        __m256d relation = otherCode;
+        relation = _mm256_blendv_pd(relation, containedCode, contained);
+        relation = _mm256_blendv_pd(relation, inscribeCode, inscribe);
+        relation = _mm256_blendv_pd(relation, overlappedCode, overlapped);
+        relation = _mm256_blendv_pd(relation, circumscribeCode, circumscribe);
+        relation = _mm256_blendv_pd(relation, separatedCode, separated);
+        relation = _mm256_blendv_pd(relation, coincideCode, coincide);
+
+        int codes[4];
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(codes), _mm256_cvtpd_epi32(relation));
+        for (int k = 0; k < 4; k++)
+        {
+            out[i + k] = static_cast<CCircle::Relation>(codes[k]);
+        }
+    }
+
+    // Remaining pairs
+    relateScalar(x1 + i * stride1, y1 + i * stride1, r1 + i * stride1, stride1,
+                 x2 + i, y2 + i, r2 + i, count - i, out + i);
+}
+#endif // CCIRCLE_X86
+
+// Fastest kernel this CPU can run, chosen on first use
+static RelationKernel relationKernel()
+{
+#ifdef CCIRCLE_X86
+    static const RelationKernel kernel = __builtin_cpu_supports("avx2") ? relateAvx2 : relateScalar;
+    return kernel;
+#else
+    return relateScalar;
+#endif
+}
+
+// Relation of first[i] to second[i] for every i
+void relatePairs(const CircleBatch& first, const CircleBatch& second, CCircle::Relation* out)
+{
+    if (first.size() != second.size())
+    {
+        throw invalid_argument("relatePairs(): Batches differ in size");
+    }
+    relationKernel()(first.x.data(), first.y.data(), first.radius.data(), 1,
+                     second.x.data(), second.y.data(), second.radius.data(), first.size(), out);
+}
+
+// Relation of circle to every circle of batch
+void relateToAll(const CCircle& circle, const CircleBatch& batch, CCircle::Relation* out)
+{
+    double x = circle.getX();
+    double y = circle.getY();
+    double radius = circle.getRadius();
+    relationKernel()(&x, &y, &radius, 0, batch.x.data(), batch.y.data(), batch.radius.data(), batch.size(), out);
+}
+
+// Two circles of an index that are not SEPARATED
+struct CirclePair
+{
+    int first;                  // Index of the first circle
+    int second;                 // Index of the second circle, always greater than first
+    CCircle::Relation relation; // How the first relates to the second
+};
+
+// Uniform grid over the bounding boxes of a set of circles. Each circle is
+// listed in every cell its box touches, so two circles that meet share a cell;
+// a pair is only examined in the cell holding the lower-left corner of the
+// overlap of their boxes, which reports every pair once without a seen-set.
+// Boxes reach CCircle::epsilon() past the radius, so circles that touch only
+// within the comparison threshold, or after rounding, still share a cell.
+class CircleGrid
+{
+private:
+    CircleBatch circles;   // Indexed circles
+    double originX;        // Lower-left corner of the grid
+    double originY;
+    double cellSize;       // Side of a square cell
+    int columns;           // Cells across
+    int rows;              // Cells down
+    vector<int> cellStart; // Offset of each cell's list in cellItems, plus an end marker
+    vector<int> cellItems; // Circle indices, grouped by cell
+
+    // Cell coordinates, clamped before the conversion so points far outside the grid stay defined
+    int column(double x) const { return static_cast<int>(min<double>(columns - 1, max(0.0, floor((x - originX) / cellSize)))); }
+    int row(double y) const { return static_cast<int>(min<double>(rows - 1, max(0.0, floor((y - originY) / cellSize)))); }
+    double reach(int i) const { return circles.radius[i] + CCircle::epsilon(); } // Half side of the box of circle i
+
+    // Cell examining the pair of box (minX, minY, ...) and circle j
+    int ownerCell(double minX, double minY, int j) const
+    {
+        return row(max(minY, circles.y[j] - reach(j))) * columns +
+               column(max(minX, circles.x[j] - reach(j)));
+    }
+
+    // Call visit(cell) for each cell the box of half side halfSide around (x, y) touches
+    template <typename Visit>
+    void forEachCell(double x, double y, double halfSide, Visit visit) const
+    {
+        int lastRow = row(y + halfSide);
+        int lastColumn = column(x + halfSide);
+        for (int r = row(y - halfSide); r <= lastRow; r++)
+        {
+            for (int c = column(x - halfSide); c <= lastColumn; c++)
+            {
+                visit(r * columns + c);
+            }
+        }
+    }
+
+public:
+    explicit CircleGrid(const CircleBatch& circles); // Build the grid
+
+    int size() const { return circles.size(); } // Number of circles
+    vector<CirclePair> interactingPairs() const; // Every pair that is not SEPARATED
+    vector<CirclePair> interactingWith(const CCircle& circle) const; // Circles that circle is not SEPARATED from
+    vector<CirclePair> interactingWith(int index) const; // Other circles that circle index is not SEPARATED from
+};
+
+// Build the grid, sizing cells to about one circle across, with no more than
+// a few cells per circle
+CircleGrid::CircleGrid(const CircleBatch& circles) :
+    circles(circles), originX(0), originY(0), cellSize(1), columns(1), rows(1)
+{
+    int n = circles.size();
+    if (n > 0)
+    {
+        double maxX = -HUGE_VAL, maxY = -HUGE_VAL, radiusSum = 0;
+        originX = HUGE_VAL;
+        originY = HUGE_VAL;
+        for (int i = 0; i < n; i++)
+        {
+            originX = min(originX, circles.x[i] - reach(i));
+            originY = min(originY, circles.y[i] - reach(i));
+            maxX = max(maxX, circles.x[i] + reach(i));
+            maxY = max(maxY, circles.y[i] + reach(i));
+            radiusSum += circles.radius[i];
+        }
+
+        double width = maxX - originX;
+        double height = maxY - originY;
+        cellSize = 2 * radiusSum / n;
+        double cellLimit = min(4.0 * n, static_cast<double>(1 << 28)); // Also keeps cell indices within int
+        if (width * height / (cellSize * cellSize) > cellLimit)
+        {
+            cellSize = sqrt(width * height / cellLimit);
+        }
+        if (max(width, height) / cellSize > cellLimit - 1)
+        {
+            cellSize = max(width, height) / (cellLimit - 1); // A long thin field must not pile into its last cell
+        }
+        columns = static_cast<int>(min(width / cellSize, cellLimit - 1)) + 1;
+        rows = static_cast<int>(min(height / cellSize, cellLimit - 1)) + 1;
+    }
+
+    // Count the circles of each cell, then place them
+    cellStart.assign(static_cast<size_t>(columns) * rows + 1, 0);
+    for (int i = 0; i < n; i++)
+    {
+        forEachCell(circles.x[i], circles.y[i], reach(i), [this](int cell) { cellStart[cell + 1]++; });
+    }
+    for (size_t cell = 1; cell < cellStart.size(); cell++)
+    {
+        cellStart[cell] += cellStart[cell - 1];
+    }
+    cellItems.resize(cellStart.back());
+    vector<int> fill(cellStart.begin(), cellStart.end() - 1);
+    for (int i = 0; i < n; i++)
+    {
+        forEachCell(circles.x[i], circles.y[i], reach(i), [this, &fill, i](int cell) { cellItems[fill[cell]++] = i; });
+    }
+}
+
+// Every pair that is not SEPARATED, each reported once with first < second
+vector<CirclePair> CircleGrid::interactingPairs() const
+{
+    vector<CirclePair> pairs;
+    for (int cell = 0; cell + 1 < static_cast<int>(cellStart.size()); cell++)
+    {
+        for (int a = cellStart[cell]; a < cellStart[cell + 1]; a++)
+        {
+            int i = cellItems[a];
+            double minX = circles.x[i] - reach(i);
+            double minY = circles.y[i] - reach(i);
+            for (int b = a + 1; b < cellStart[cell + 1]; b++)
+            {
+                int j = cellItems[b];
+                if (ownerCell(minX, minY, j) != cell)
+                {
+                    continue; // Examined in another cell
+                }
+
+                double dx = circles.x[i] - circles.x[j];
+                double dy = circles.y[i] - circles.y[j];
+                CCircle::Relation relation = CCircle::classifySquared(dx * dx + dy * dy, circles.radius[i], circles.radius[j]);
+                if (relation != CCircle::Relation::SEPARATED)
+                {
+                    pairs.push_back({i, j, relation}); // i < j as cells list circles in index order
+                }
+            }
+        }
+    }
+    return pairs;
+}
+
+// Circles that circle is not SEPARATED from; first is -1 and second the index
+vector<CirclePair> CircleGrid::interactingWith(const CCircle& circle) const
+{
+    vector<CirclePair> found;
+    double x = circle.getX();
+    double y = circle.getY();
+    double radius = circle.getRadius();
+    double halfSide = radius + CCircle::epsilon();
+    if (circles.size() == 0)
+    {
+        return found;
+    }
+
+    forEachCell(x, y, halfSide, [&](int cell)
+    {
+        for (int a = cellStart[cell]; a < cellStart[cell + 1]; a++)
+        {
+            int j = cellItems[a];
+            if (ownerCell(x - halfSide, y - halfSide, j) != cell)
+            {
+                continue; // Examined in another cell
+            }
+
+            double dx = x - circles.x[j];
+            double dy = y - circles.y[j];
+            CCircle::Relation relation = CCircle::classifySquared(dx * dx + dy * dy, radius, circles.radius[j]);
+            if (relation != CCircle::Relation::SEPARATED)
+            {
+                found.push_back({-1, j, relation});
+            }
+        }
+    });
+    return found;
+}
+
+// Other circles that circle index is not SEPARATED from, with first set to index
+vector<CirclePair> CircleGrid::interactingWith(int index) const
+{
+    if (index < 0 || index >= circles.size())
+    {
+        throw out_of_range("CircleGrid::interactingWith(): Index out of range");
+    }
+
+    CCircle circle(circles.radius[index], circles.x[index], circles.y[index]);
+    vector<CirclePair> found = interactingWith(circle);
+    found.erase(remove_if(found.begin(), found.end(), [index](const CirclePair& pair) { return pair.second == index; }),
+                found.end());
+    for (CirclePair& pair : found)
+    {
+        pair.first = index;
+    }
+    return found;
+}
+
+// Relation of every circle to every other, three bits per entry packed
+// 21 to a 64-bit word; each row starts on a fresh word
+class RelationMatrix
+{
+private:
+    int n;                  // Number of circles
+    int wordsPerRow;        // Words holding one row
+    vector<uint64_t> words; // Packed entries, row by row
+
+public:
+    static const int BITS = 3;                // Bits per entry
+    static const int PER_WORD = 64 / BITS;    // Entries per word
+
+    explicit RelationMatrix(int n = 0) :
+        n(n), wordsPerRow((n + PER_WORD - 1) / PER_WORD), words(static_cast<size_t>(wordsPerRow) * n, 0) {}
+
+    int size() const { return n; } // Number of rows and columns
+    size_t bytes() const { return words.size() * sizeof(uint64_t); } // Memory held by the entries
+
+    // Relation of circle i to circle j
+    CCircle::Relation at(int i, int j) const
+    {
+        if (i < 0 || i >= n || j < 0 || j >= n)
+        {
+            throw out_of_range("RelationMatrix::at(): Index out of range");
+        }
+        uint64_t word = words[static_cast<size_t>(i) * wordsPerRow + j / PER_WORD];
+        return static_cast<CCircle::Relation>((word >> (j % PER_WORD * BITS)) & 7);
+    }
+
+    // Word w of row i, for filling the matrix a whole word at a time
+    uint64_t& word(int i, int w) { return words[static_cast<size_t>(i) * wordsPerRow + w]; }
+};
+
+// Rows and packed words of one tile of the matrix; a tile's columns fill
+// whole words, so tiles never share a word and need no locking
+const int TILE_ROWS = 64;
+const int TILE_WORDS = 32;
+
+// Compute the full relation matrix of circles in tiles handed out to threads
+// through an atomic counter; 0 threads means one per core
+RelationMatrix relationMatrix(const CircleBatch& circles, int threads = 0)
+{
+    int n = circles.size();
+    RelationMatrix matrix(n);
+    if (n == 0)
+    {
+        return matrix;
+    }
+    if (threads <= 0)
+    {
+        threads = max(1, static_cast<int>(thread::hardware_concurrency()));
+    }
+
+    const int tileColumns = TILE_WORDS * RelationMatrix::PER_WORD;
+    int rowTiles = (n + TILE_ROWS - 1) / TILE_ROWS;
+    int columnTiles = (n + tileColumns - 1) / tileColumns;
+    int tiles = rowTiles * columnTiles;
+    threads = min(threads, tiles);
+    RelationKernel kernel = relationKernel();
+
+    atomic<int> nextTile(0);
+    mutex failureLock;
+    exception_ptr failure;
+    auto work = [&]()
+    {
+        try
+        {
+            vector<CCircle::Relation> relations(tileColumns);
+            for (int tile; (tile = nextTile.fetch_add(1)) < tiles; )
+            {
+                // Walk along a row of tiles so the same circles stay in cache
+                int firstRow = tile / columnTiles * TILE_ROWS;
+                int firstColumn = tile % columnTiles * tileColumns;
+                int lastRow = min(n, firstRow + TILE_ROWS);
+                int count = min(n - firstColumn, tileColumns);
+                for (int i = firstRow; i < lastRow; i++)
+                {
+                    kernel(&circles.x[i], &circles.y[i], &circles.radius[i], 0,
+                           circles.x.data() + firstColumn, circles.y.data() + firstColumn,
+                           circles.radius.data() + firstColumn, count, relations.data());
+
+                    int firstWord = firstColumn / RelationMatrix::PER_WORD;
+                    for (int k = 0; k < count; k += RelationMatrix::PER_WORD)
+                    {
+                        uint64_t packed = 0;
+                        int end = min(count, k + RelationMatrix::PER_WORD);
+                        for (int j = k; j < end; j++)
+                        {
+                            packed |= static_cast<uint64_t>(relations[j]) << ((j - k) * RelationMatrix::BITS);
+                        }
+                        matrix.word(i, firstWord + k / RelationMatrix::PER_WORD) = packed;
+                    }
+                }
+            }
+        }
+        catch (...)
+        {
+            lock_guard<mutex> guard(failureLock);
+            if (!failure)
+            {
+                failure = current_exception();
+            }
+            nextTile = tiles; // Stop the other workers
+        }
+    };
+
+    vector<thread> workers;
+    for (int t = 1; t < threads; t++)
+    {
+        workers.emplace_back(work);
+    }
+    work(); // The calling thread takes tiles as well
+    for (thread& worker : workers)
+    {
+        worker.join();
+    }
+    if (failure)
+    {
+        rethrow_exception(failure);
+    }
+    return matrix;
+}
+
+// Random circle with integer-valued centre and radius, so tangent and
+// coincident pairs turn up as well as the general cases
+static CCircle randomCircle()
+{
+    return CCircle(1 + rand() % 8, rand() % 24, rand() % 24);
+}
+
+// Pairs per second of determineRelation against the scalar and dispatched batch kernels
+void runBenchmarks()
+{
+    const int n = 1 << 20;
+    vector<CCircle> firstCircles, secondCircles;
+    CircleBatch first, second;
+    for (int i = 0; i < n; i++)
+    {
+        firstCircles.push_back(randomCircle());
+        secondCircles.push_back(randomCircle());
+        first.add(firstCircles.back());
+        second.add(secondCircles.back());
+    }
+
+    vector<CCircle::Relation> expected(n), scalar(n), batched(n);
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < n; i++)
+    {
+        expected[i] = firstCircles[i].determineRelation(secondCircles[i]);
+    }
+    double pairwise = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    start = chrono::steady_clock::now();
+    relateScalar(first.x.data(), first.y.data(), first.radius.data(), 1,
+                 second.x.data(), second.y.data(), second.radius.data(), n, scalar.data());
+    double scalarTime = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    start = chrono::steady_clock::now();
+    relatePairs(first, second, batched.data());
+    double batchTime = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    int mismatches = 0;
+    for (int i = 0; i < n; i++)
+    {
+        if (expected[i] != scalar[i] || scalar[i] != batched[i])
+        {
+            mismatches++;
+        }
+    }
+
+    bool avx2 = (relationKernel() != relateScalar);
+    cout << n << " pairs: determineRelation " << n / pairwise / 1e6 << " M pairs/s, scalar batch "
+         << n / scalarTime / 1e6 << " M pairs/s, " << (avx2 ? "AVX2" : "scalar") << " batch "
+         << n / batchTime / 1e6 << " M pairs/s, " << mismatches << " mismatches" << endl;
+
+    // Interacting pairs through the grid against checking every pair
+    for (int count : {4000, 200000})
+    {
+        CircleBatch field;
+        double side = sqrt(count * 40.0); // About one neighbour per circle
+        for (int i = 0; i < count; i++)
+        {
+            field.add(CCircle(0.5 + rand() % 4, rand() / (double)RAND_MAX * side, rand() / (double)RAND_MAX * side));
+        }
+
+        start = chrono::steady_clock::now();
+        CircleGrid grid(field);
+        vector<CirclePair> pairs = grid.interactingPairs();
+        double gridTime = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        cout << count << " circles: grid found " << pairs.size() << " interacting pairs in " << gridTime << " ms";
+
+        if (count <= 10000)
+        {
+            start = chrono::steady_clock::now();
+            vector<CCircle::Relation> relations(count);
+            long long bruteCount = 0;
+            for (int i = 0; i < count; i++)
+            {
+                CCircle circle(field.radius[i], field.x[i], field.y[i]);
+                relateToAll(circle, field, relations.data());
+                for (int j = i + 1; j < count; j++)
+                {
+                    bruteCount += (relations[j] != CCircle::Relation::SEPARATED);
+                }
+            }
+            double bruteTime = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+            cout << ", all pairs found " << bruteCount << " in " << bruteTime << " ms";
+        }
+        cout << endl;
+    }
+
+    // Full relation matrix on growing numbers of threads
+    const int matrixSize = 8000;
+    CircleBatch field;
+    for (int i = 0; i < matrixSize; i++)
+    {
+        field.add(randomCircle());
+    }
+    int cores = max(1, static_cast<int>(thread::hardware_concurrency()));
+    for (int threads = 1; ; threads = min(threads * 2, cores))
+    {
+        start = chrono::steady_clock::now();
+        RelationMatrix matrix = relationMatrix(field, threads);
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+        int wrong = 0;
+        for (int k = 0; k < 10000; k++)
+        {
+            int i = rand() % matrixSize;
+            int j = rand() % matrixSize;
+            double dx = field.x[i] - field.x[j];
+            double dy = field.y[i] - field.y[j];
+            wrong += (matrix.at(i, j) != CCircle::classifySquared(dx * dx + dy * dy, field.radius[i], field.radius[j]));
+        }
+        cout << matrixSize << "x" << matrixSize << " matrix on " << threads << " thread(s): "
+             << 1.0 * matrixSize * matrixSize / seconds / 1e6 << " M entries/s, " << matrix.bytes() / 1e6
+             << " MB, " << wrong << " wrong in 10000 samples" << endl;
+        if (threads == cores)
+        {
+            break;
+        }
+    }
+}
+
+// Index a few circles and list the ones touching each other
+void runGridDemo()
+{
+    CCircle c1(3);
+    CCircle c2(2, 4, 3);
+    CircleBatch circles;
+    circles.add(c1);
+    circles.add(c2);
+    circles.add(CCircle(1, 1, 0));
+    circles.add(CCircle(1, 20, 20));
+    CircleGrid grid(circles);
+    for (const CirclePair& pair : grid.interactingPairs())
+    {
+        cout << "Circles " << pair.first << " and " << pair.second << ": " << c1.relationToString(pair.relation) << endl;
+    }
+    cout << "Circle 0 interacts with " << grid.interactingWith(0).size() << " other circle(s)" << endl;
+
+    // Tangent circles whose boxes meet on a cell boundary; rounding x + r and
+    // x - r alone would leave them in different cells
+    CCircle left(7.2, 0.9, 0);
+    CCircle right(7.2, 15.3, 0);
+    CircleBatch tangent;
+    tangent.add(left);
+    tangent.add(right);
+    CircleGrid tangentGrid(tangent);
+    cout << "Tangent circles are " << left.relationship(right) << ", grid finds "
+         << tangentGrid.interactingPairs().size() << " pair(s)" << endl;
+}
+
 // Test the CCircle class and its relationship determination
-int main()
+// Run with --bench to time the batch relationship kernels, or with --grid to
+// list the interacting pairs of a few indexed circles
+int main(int argc, char* argv[])
 {
+    if (argc > 1 && string(argv[1]) == "--bench")
+    {
+        runBenchmarks();
+        return 0;
+    }
+    if (argc > 1 && string(argv[1]) == "--grid")
+    {
+        runGridDemo();
+        return 0;
+    }
+
     CCircle c1(3); // 3 is radius
     CCircle c2(2, 4, 3); // 2 is radius, 4 is x-coordinate,3 is y-coordiante.
     cout << "The relationship is " << c1.relationship(c2) << endl;